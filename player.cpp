@@ -1,367 +1,2902 @@
-#include <iostream>
-#include <fstream>
-#include <array>
-#include <set>
-#include <string>
-#include <vector>
-#include <queue>
-#include <cstdlib>
-#include <ctime>
-using namespace std;
-const int SIZE = 8;
-const int INF_VALUE = 0x7FFFFFFF;
-// 1 (O) 2 (O) 3 (O) 4 (O) 5 (O)
-// 5 (O) 4 (O) 3 (O) 2 (O) 1 (O)
-struct Point {
-    int x, y;
-	Point() : Point(0, 0) {}
-	Point(int x, int y) : x(x), y(y) {}
-	bool operator==(const Point& rhs) const {
-		return x == rhs.x && y == rhs.y;
-	}
-	bool operator!=(const Point& rhs) const {
-		return !operator==(rhs);
-	}
-	Point operator+(const Point& rhs) const {
-		return Point(x + rhs.x, y + rhs.y);
-	}
-	Point operator-(const Point& rhs) const {
-		return Point(x - rhs.x, y - rhs.y);
-	}
-};
-
-class OthelloBoard {
-private:
-    enum SPOT_STATE {
-        EMPTY = 0,
-        BLACK = 1,
-        WHITE = 2
-    };
-    static const int SIZE = 8;
-    const std::array<Point, 8> directions{{
-        Point(-1, -1), Point(-1, 0), Point(-1, 1),
-        Point(0, -1), /*{0, 0}, */Point(0, 1),
-        Point(1, -1), Point(1, 0), Point(1, 1)
-    }};
-    array<array<int, SIZE>, SIZE> board;
-    vector<Point> next_valid_spots;
-    array<int, 3> disc_count;
-    int cur_player;
-    bool done;
-    int winner;
-private:
-    // 下一手是黑子還白子下
-    int get_next_player(int player) const {
-        return 3 - player;
-    }
-    // 點是否在棋盤內
-    bool is_spot_on_board(Point p) const {
-        return 0 <= p.x && p.x < SIZE && 0 <= p.y && p.y < SIZE;
-    }
-    // 這個點是什麼棋(黑白空)
-    int get_disc(Point p) const {
-        return board[p.x][p.y];
-    }
-    // 設置這格是什麼棋
-    void set_disc(Point p, int disc) {
-        board[p.x][p.y] = disc;
-    }
-    // 
-    bool is_disc_at(Point p, int disc) const {
-        if (!is_spot_on_board(p))
-            return false;
-        if (get_disc(p) != disc)
-            return false;
-        return true;
-    }
-    // 判斷這步棋能不能下(判斷棋布合法)
-    bool is_spot_valid(Point center) const {
-        if (get_disc(center) != EMPTY)
-            return false;
-        for (Point dir: directions) {
-            // Move along the direction while testing.
-            Point p = center + dir;
-            if (!is_disc_at(p, get_next_player(cur_player)))
-                continue;
-            p = p + dir;
-            while (is_spot_on_board(p) && get_disc(p) != EMPTY) {
-                if (is_disc_at(p, cur_player))
-                    return true;
-                p = p + dir;
-            }
-        }
-        return false;
-    }
-    // 更新棋盤
-    void flip_discs(Point center) {
-        for (Point dir: directions) {
-            // Move along the direction while testing.
-            Point p = center + dir;
-            if (!is_disc_at(p, get_next_player(cur_player)))
-                continue;
-            std::vector<Point> discs({p});
-            p = p + dir;
-            while (is_spot_on_board(p) && get_disc(p) != EMPTY) {
-                if (is_disc_at(p, cur_player)) {
-                    for (Point s: discs) {
-                        set_disc(s, cur_player);
-                    }
-                    disc_count[cur_player] += discs.size();
-                    disc_count[get_next_player(cur_player)] -= discs.size();
-                    break;
-                }
-                discs.push_back(p);
-                p = p + dir;
-            }
-        }
-    }
-public:
-    OthelloBoard(array<array<int, SIZE>, SIZE> board, vector<Point> next_valid_spots, int cur_player)
-    :board(board), next_valid_spots(next_valid_spots), cur_player(cur_player) {
-        disc_count[EMPTY] = 0;
-        disc_count[BLACK] = 0;
-        disc_count[WHITE] = 0;
-        for (int i = 0; i < SIZE; i++) {
-            for (int j = 0; j < SIZE; j++) {
-                if(board[i][j] == BLACK)
-                    disc_count[BLACK] ++;
-                else if(board[i][j] == WHITE)
-                    disc_count[WHITE] ++;
-            }
-        }
-        done = false;
-        winner = -1;
-    }
-    OthelloBoard(const OthelloBoard & round){
-        for (int i = 0; i < SIZE; i++) {
-            for (int j = 0; j < SIZE; j++) {
-                board[i][j] = round.board[i][j];
-            }
-        }
-        next_valid_spots = round.next_valid_spots;
-        cur_player = round.cur_player;
-        disc_count[EMPTY] = round.disc_count[EMPTY];
-        disc_count[BLACK] = round.disc_count[BLACK];
-        disc_count[WHITE] = round.disc_count[WHITE];
-        done = false;
-        winner = -1;
-    }
-    // 下這步棋後對手可下的地方(已經排除掉不合法棋步)
-    vector<Point> get_valid_spots() const {
-        vector<Point> valid_spots;
-        for (int i = 0; i < SIZE; i++) {
-            for (int j = 0; j < SIZE; j++) {
-                Point p = Point(i, j);
-                if (board[i][j] != EMPTY)
-                    continue;
-                if (is_spot_valid(p))
-                    valid_spots.push_back(p);
-            }
-        }
-        return valid_spots;
-    }
-    // 下這步棋
-    bool put_disc(Point p) {
-        if(!is_spot_valid(p)) {
-            winner = get_next_player(cur_player);
-            done = true;
-            return false;
-        }
-        set_disc(p, cur_player);
-        disc_count[cur_player]++;
-        disc_count[EMPTY]--;
-        flip_discs(p);
-        // Give control to the other player.
-        cur_player = get_next_player(cur_player);
-        next_valid_spots = get_valid_spots();
-        return true;
-    }
-    //
-    vector<Point> get_cur_next_valid_spots(){
-        return next_valid_spots;
-    }
-    //
-    array<array<int, SIZE>, SIZE> get_cur_board(){
-        return board;
-    }
-    //
-    int get_cur_player(){
-        return cur_player;
-    }
-    //
-    int get_gap(){
-        return disc_count[cur_player] - disc_count[get_next_player(cur_player)];
-    }
-    int get_dics_num(){
-        return disc_count[cur_player] + disc_count[get_next_player(cur_player)];
-    }
-    bool get_done(){
-        return done;
-    }
-};
-
-class AI {
-private:
-    // state value
-    int state_value[8][8] = {
-        500, -25, 10, 5, 5, 10, -25, 500,
-        -25, -50, -5, 1, 1, -5, -50, -25,
-        10, -5, 2, 2, 2, 2, -5, 10,
-        5, 1, 2, -3, -3, 2, 1, 5,
-        5, 1, 2, -3, -3, 2, 1, 5,
-        10, -5, 2, 2, 2, 2, -5, 10,
-        -25, -50, -5, 1, 1, -5, -50, -25,
-        500 , -25, 10, 5, 5, 10, -25, 500,
-    };
-    int limit_depth = 5;
-    // informations
-    OthelloBoard & first_round;
-    array<array<int, SIZE>, SIZE> board;
-    vector<Point> next_valid_spots;
-    int cur_player;
-public:
-    AI(OthelloBoard & first_round):first_round(first_round) {
-        board = first_round.get_cur_board();
-        next_valid_spots = first_round.get_cur_next_valid_spots();
-        cur_player = first_round.get_cur_player();
-    }
-    // state value
-    int evaluation(OthelloBoard & round, Point p){
-        OthelloBoard game  = round;
-        int value = 0;
-        game.put_disc(p);
-
-        // 落下這個點後盤面分數
-        int state = 0;
-        for(int i = 0; i < SIZE; i++){
-            for(int j = 0; j < SIZE; j++){
-                if(game.get_cur_board()[i][j] == round.get_cur_player())
-                    state += state_value[i][j];
-                else if(game.get_cur_board()[i][j] == 3 - round.get_cur_player())
-                    state -= state_value[i][j];
-            }
-        }
-        // 對方行動力
-        int mob = 0;
-        mob = -game.get_cur_next_valid_spots().size();
-        // 下這個點後對方與自己的棋子數目差
-        int gap = 0;
-        gap = -game.get_gap();
-
-        value = state + mob * 10 + gap;
-        return value;
-    }
-    // close end game
-    int end_game_value(OthelloBoard & round){
-        OthelloBoard game  = round;
-        int value = 0;
-
-        // 盤面分數
-        int state = 0;
-        for(int i = 0; i < SIZE; i++){
-            for(int j = 0; j < SIZE; j++){
-                if(game.get_cur_board()[i][j] == round.get_cur_player())
-                    state += state_value[i][j];
-                else if(game.get_cur_board()[i][j] == 3 - round.get_cur_player())
-                    state -= state_value[i][j];
-            }
-        }
-        // 自己與對方的棋子數目差
-        int gap = 0;
-        gap = game.get_gap();
-
-        value = state + gap;
-        return value;
-    }
-    // minimax recursion ()
-    // this round(), choice point, depth, opponenet or me, alpha, beta
-    int minimax(OthelloBoard & round, Point choice_point, int depth, bool player_type, int alpha, int beta){
-        if(depth == limit_depth){
-            return evaluation(round, choice_point);
-        }
-        OthelloBoard next_round(round);
-        next_round.put_disc(choice_point);
-        if(player_type){
-            int best_value = -INF_VALUE;
-            if(next_round.get_cur_next_valid_spots().size() == 0){
-                return end_game_value(next_round);
-            }
-            for(auto p:next_round.get_cur_next_valid_spots()){
-                best_value = max(best_value, minimax(next_round, p, depth + 1, false, alpha, beta));
-                alpha = max(alpha, best_value);
-                if(alpha >= beta) break;
-            }
-            return best_value;
-        } else {
-            int best_value = INF_VALUE;
-            for(auto p:next_round.get_cur_next_valid_spots()){
-                best_value = min(best_value, minimax(next_round, p, depth + 1, true, alpha, beta));
-                beta = min(beta, best_value);
-                if(beta <= alpha) break;
-            }
-            return best_value;
-        }
-    }
-    // return the best choice this round
-    Point best_choice(){
-        int max_value = -INF_VALUE;
-        int n_valid_spots_value[50] = {0};
-        int choice_idx = -1;
-        for(long unsigned int i = 0; i < next_valid_spots.size(); i++){
-            n_valid_spots_value[i] = minimax(first_round, next_valid_spots[i], 1, false, -INF_VALUE, INF_VALUE);
-            if(max_value < n_valid_spots_value[i]){
-                max_value = n_valid_spots_value[i];
-                choice_idx = i;
-            }
-        }
-        return next_valid_spots[choice_idx];
-    }
-};
-
-class Engine {
-private:
-    int player;
-    array<array<int, SIZE>, SIZE> board;
-    vector<Point> next_valid_spots;
-public:
-    void read_board(std::ifstream& fin) {
-        fin >> player;
-        for (int i = 0; i < SIZE; i++) {
-            for (int j = 0; j < SIZE; j++) {
-                fin >> board[i][j];
-            }
-        }
-    }
-    void read_valid_spots(std::ifstream& fin) {
-        int n_valid_spots;
-        fin >> n_valid_spots;
-        int x, y;
-        for (int i = 0; i < n_valid_spots; i++) {
-            fin >> x >> y;
-            next_valid_spots.push_back({x, y});
-        }
-    }
-
-    void write_valid_spot(std::ofstream& fout) {
-        long unsigned int n_valid_spots = next_valid_spots.size();
-        OthelloBoard first_round(board, next_valid_spots, player);
-        AI ai(first_round);
-        Point p = ai.best_choice();
-        // Remember to flush the output to ensure the last action is written to file.
-        fout << p.x << " " << p.y << std::endl;
-        fout.flush();
-    }
-};
-
-int main(int, char **argv)
-{
-    std::ifstream fin(argv[1]);
-    std::ofstream fout(argv[2]);
-    Engine engine;
-    engine.read_board(fin);
-    engine.read_valid_spots(fin);
-    engine.write_valid_spot(fout);
-    fin.close();
-    fout.close();
-    return 0;
+#include <iostream>
+#include <fstream>
+#include <array>
+#include <set>
+#include <string>
+#include <vector>
+#include <queue>
+#include <cstdlib>
+#include <ctime>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <filesystem>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define HAVE_X86_SIMD 1
+#endif
+using namespace std;
+const int SIZE = 8;
+const int INF_VALUE = 0x7FFFFFFF;
+// 程式開始的時間: 只跑一步的模式從這裡開始算時間, 配置置換表等啟動的時間也算在內
+const chrono::steady_clock::time_point PROCESS_START = chrono::steady_clock::now();
+// 1 (O) 2 (O) 3 (O) 4 (O) 5 (O)
+// 5 (O) 4 (O) 3 (O) 2 (O) 1 (O)
+struct Point {
+    int x, y;
+	Point() : Point(0, 0) {}
+	Point(int x, int y) : x(x), y(y) {}
+	bool operator==(const Point& rhs) const {
+		return x == rhs.x && y == rhs.y;
+	}
+	bool operator!=(const Point& rhs) const {
+		return !operator==(rhs);
+	}
+	Point operator+(const Point& rhs) const {
+		return Point(x + rhs.x, y + rhs.y);
+	}
+	Point operator-(const Point& rhs) const {
+		return Point(x - rhs.x, y - rhs.y);
+	}
+};
+
+// 位元棋盤: 第 x * 8 + y 個 bit 代表 (x, y) 這格
+inline int to_square(Point p) {
+    return p.x * SIZE + p.y;
+}
+inline Point to_point(int sq) {
+    return Point(sq >> 3, sq & 7);
+}
+inline int popcount(uint64_t b) {
+    return __builtin_popcountll(b);
+}
+// 最低位的格子
+inline int first_square(uint64_t b) {
+    return __builtin_ctzll(b);
+}
+// 8 個方向: 前 4 個往左移, 後 4 個往右移, 遮罩擋掉左右邊界的繞回
+const int DIR_SHIFT[4] = {1, 8, 9, 7};
+const uint64_t DIR_MASK[8] = {
+    0xFEFEFEFEFEFEFEFEULL, 0xFFFFFFFFFFFFFFFFULL, 0xFEFEFEFEFEFEFEFEULL, 0x7F7F7F7F7F7F7F7FULL,
+    0x7F7F7F7F7F7F7F7FULL, 0xFFFFFFFFFFFFFFFFULL, 0x7F7F7F7F7F7F7F7FULL, 0xFEFEFEFEFEFEFEFEULL
+};
+inline uint64_t shift_dir(uint64_t b, int d) {
+    if (d < 4)
+        return (b << DIR_SHIFT[d]) & DIR_MASK[d];
+    return (b >> DIR_SHIFT[d - 4]) & DIR_MASK[d];
+}
+// 行動力用的傳遞遮罩: 邊上的對手子不可能被夾在中間, 拿掉後位移不會繞回
+const uint64_t MOB_MASK[4] = {
+    0x7E7E7E7E7E7E7E7EULL, 0x00FFFFFFFFFFFF00ULL, 0x007E7E7E7E7E7E00ULL, 0x007E7E7E7E7E7E00ULL
+};
+// 輪到 P 下時所有合法位置 (Kogge-Stone fill, 每個方向 3 步)
+uint64_t get_moves_scalar(uint64_t P, uint64_t O) {
+    uint64_t moves = 0;
+    for (int d = 0; d < 4; d++) {
+        const int s = DIR_SHIFT[d];
+        uint64_t pro = O & MOB_MASK[d];
+        uint64_t pro2 = pro & (pro << s);
+        uint64_t pro4 = pro2 & (pro2 << 2 * s);
+        uint64_t gen = pro & (P << s);
+        gen |= pro & (gen << s);
+        gen |= pro2 & (gen << 2 * s);
+        gen |= pro4 & (gen << 4 * s);
+        moves |= gen << s;
+        pro2 = pro & (pro >> s);
+        pro4 = pro2 & (pro2 >> 2 * s);
+        gen = pro & (P >> s);
+        gen |= pro & (gen >> s);
+        gen |= pro2 & (gen >> 2 * s);
+        gen |= pro4 & (gen >> 4 * s);
+        moves |= gen >> s;
+    }
+    return moves & ~(P | O);
+}
+#ifdef HAVE_X86_SIMD
+// 4 個 lane 各做一個方向, 左右移各一組
+__attribute__((target("avx2")))
+uint64_t get_moves_avx2(uint64_t P, uint64_t O) {
+    const __m256i s1 = _mm256_set_epi64x(7, 9, 8, 1);
+    const __m256i s2 = _mm256_add_epi64(s1, s1);
+    const __m256i s4 = _mm256_add_epi64(s2, s2);
+    const __m256i PP = _mm256_set1_epi64x(P);
+    const __m256i pro = _mm256_and_si256(_mm256_set1_epi64x(O),
+        _mm256_set_epi64x(MOB_MASK[3], MOB_MASK[2], MOB_MASK[1], MOB_MASK[0]));
+    __m256i pro2 = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, s1));
+    __m256i pro4 = _mm256_and_si256(pro2, _mm256_sllv_epi64(pro2, s2));
+    __m256i gen = _mm256_and_si256(pro, _mm256_sllv_epi64(PP, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, s1)));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro2, _mm256_sllv_epi64(gen, s2)));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro4, _mm256_sllv_epi64(gen, s4)));
+    __m256i moves = _mm256_sllv_epi64(gen, s1);
+    pro2 = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, s1));
+    pro4 = _mm256_and_si256(pro2, _mm256_srlv_epi64(pro2, s2));
+    gen = _mm256_and_si256(pro, _mm256_srlv_epi64(PP, s1));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, s1)));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro2, _mm256_srlv_epi64(gen, s2)));
+    gen = _mm256_or_si256(gen, _mm256_and_si256(pro4, _mm256_srlv_epi64(gen, s4)));
+    moves = _mm256_or_si256(moves, _mm256_srlv_epi64(gen, s1));
+    __m128i m = _mm_or_si128(_mm256_castsi256_si128(moves), _mm256_extracti128_si256(moves, 1));
+    m = _mm_or_si128(m, _mm_unpackhi_epi64(m, m));
+    return (uint64_t)_mm_cvtsi128_si64(m) & ~(P | O);
+}
+// 8 個 lane 各做一個方向, 右移用 rotate 代替 (傳遞遮罩已經擋掉繞回)
+// GCC 12 的 avx512fintrin.h 裡 _mm512_undefined_epi32 會誤報 -Wuninitialized, 只在這個函式關掉
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+__attribute__((target("avx512f")))
+uint64_t get_moves_avx512(uint64_t P, uint64_t O) {
+    const __m512i s1 = _mm512_set_epi64(57, 55, 56, 63, 7, 9, 8, 1);
+    const __m512i s2 = _mm512_and_si512(_mm512_add_epi64(s1, s1), _mm512_set1_epi64(63));
+    const __m512i s4 = _mm512_and_si512(_mm512_add_epi64(s2, s2), _mm512_set1_epi64(63));
+    const __m512i mask = _mm512_set_epi64(MOB_MASK[3], MOB_MASK[2], MOB_MASK[1], MOB_MASK[0],
+        MOB_MASK[3], MOB_MASK[2], MOB_MASK[1], MOB_MASK[0]);
+    const __m512i pro = _mm512_and_si512(_mm512_set1_epi64(O), mask);
+    __m512i pro2 = _mm512_and_si512(pro, _mm512_rolv_epi64(pro, s1));
+    __m512i pro4 = _mm512_and_si512(pro2, _mm512_rolv_epi64(pro2, s2));
+    __m512i gen = _mm512_and_si512(pro, _mm512_rolv_epi64(_mm512_set1_epi64(P), s1));
+    gen = _mm512_or_si512(gen, _mm512_and_si512(pro, _mm512_rolv_epi64(gen, s1)));
+    gen = _mm512_or_si512(gen, _mm512_and_si512(pro2, _mm512_rolv_epi64(gen, s2)));
+    gen = _mm512_or_si512(gen, _mm512_and_si512(pro4, _mm512_rolv_epi64(gen, s4)));
+    return (uint64_t)_mm512_reduce_or_epi64(_mm512_rolv_epi64(gen, s1)) & ~(P | O);
+}
+#pragma GCC diagnostic pop
+#endif
+// 四個方向 (DIR_SHIFT 的順序) 上整條線都下滿的格子, 每個方向用倍增的位移一次 AND 完
+void get_full_lines(uint64_t filled, uint64_t full[4]) {
+    uint64_t h = filled & (filled >> 4);
+    h &= h >> 2;
+    h &= h >> 1;
+    full[0] = (h & 0x0101010101010101ULL) * 0xFF;
+    uint64_t v = filled & (filled >> 32);
+    v &= v >> 16;
+    v &= v >> 8;
+    full[1] = (v & 0xFF) * 0x0101010101010101ULL;
+    uint64_t l9 = filled & (((filled >> 9) & 0x007F7F7F7F7F7F7FULL) | 0xFF80808080808080ULL);
+    uint64_t r9 = filled & (((filled << 9) & 0xFEFEFEFEFEFEFE00ULL) | 0x01010101010101FFULL);
+    l9 &= ((l9 >> 18) & 0x00003F3F3F3F3F3FULL) | 0xFFFFC0C0C0C0C0C0ULL;
+    r9 &= ((r9 << 18) & 0xFCFCFCFCFCFC0000ULL) | 0x030303030303FFFFULL;
+    l9 &= ((l9 >> 36) & 0x000000000F0F0F0FULL) | 0xFFFFFFFFF0F0F0F0ULL;
+    r9 &= ((r9 << 36) & 0xF0F0F0F000000000ULL) | 0x0F0F0F0FFFFFFFFFULL;
+    full[2] = l9 & r9;
+    uint64_t l7 = filled & (((filled >> 7) & 0x00FEFEFEFEFEFEFEULL) | 0xFF01010101010101ULL);
+    uint64_t r7 = filled & (((filled << 7) & 0x7F7F7F7F7F7F7F00ULL) | 0x80808080808080FFULL);
+    l7 &= ((l7 >> 14) & 0x0000FCFCFCFCFCFCULL) | 0xFFFF030303030303ULL;
+    r7 &= ((r7 << 14) & 0x3F3F3F3F3F3F0000ULL) | 0xC0C0C0C0C0C0FFFFULL;
+    l7 &= ((l7 >> 28) & 0x00000000F0F0F0F0ULL) | 0xFFFFFFFF0F0F0F0FULL;
+    r7 &= ((r7 << 28) & 0x0F0F0F0F00000000ULL) | 0xF0F0F0F0FFFFFFFFULL;
+    full[3] = l7 & r7;
+}
+// 每個方向上有一邊是牆的格子
+const uint64_t WALL_MASK[4] = {
+    0x8181818181818181ULL, 0xFF000000000000FFULL, 0xFF818181818181FFULL, 0xFF818181818181FFULL
+};
+// 穩定子: 以後不管怎麼下都不會被翻的 P 的棋子
+// 一顆子在四個方向上都要安全: 那條線已經下滿, 或是旁邊是牆或 P 的穩定子
+// 從空集合開始反覆擴張到不動點, 角和邊會自己先長出來
+uint64_t get_stable(uint64_t P, uint64_t O) {
+    uint64_t safe[4];
+    get_full_lines(P | O, safe);
+    for (int k = 0; k < 4; k++)
+        safe[k] |= WALL_MASK[k];
+    uint64_t stable = 0;
+    while (true) {
+        uint64_t next = P;
+        for (int k = 0; k < 4; k++)
+            next &= safe[k] | shift_dir(stable, k) | shift_dir(stable, k + 4);
+        if (next == stable)
+            return stable;
+        stable = next;
+    }
+}
+// P 下在 sq 會翻掉的對手棋子
+uint64_t flip_scalar(int sq, uint64_t P, uint64_t O) {
+    uint64_t flipped = 0;
+    for (int d = 0; d < 8; d++) {
+        uint64_t line = 0;
+        uint64_t x = shift_dir(1ULL << sq, d);
+        while (x & O) {
+            line |= x;
+            x = shift_dir(x, d);
+        }
+        if (x & P)
+            flipped |= line;
+    }
+    return flipped;
+}
+
+// 查表翻棋: 一條線上 8 格, pos 是下子的位置
+// OUTFLANK[pos][中間 6 格的對手子] = 兩側連續對手子後面那一格 (要是自己的子才會翻)
+// FLIPPED[pos][outflank] = pos 和 outflank 之間被翻的格子
+uint8_t OUTFLANK[8][64];
+uint8_t FLIPPED[8][256];
+uint64_t COL_DEPOSIT[256];  // 第 i 個 bit 放到 (i, 0)
+uint64_t DIAG_MASK[64];     // 經過 sq 的 x - y 相同斜線
+uint64_t ANTI_MASK[64];     // 經過 sq 的 x + y 相同斜線
+uint64_t LINE_MASK[64][4];  // 經過 sq 的橫, 直, 兩條斜線 (給 PEXT/PDEP 用)
+int LINE_POS[64][4];        // sq 在該線上是第幾格
+bool init_flip_tables() {
+    for (int pos = 0; pos < 8; pos++) {
+        for (int o6 = 0; o6 < 64; o6++) {
+            int o = o6 << 1;
+            uint8_t out = 0;
+            int i = pos + 1;
+            while (i < 8 && (o >> i & 1))
+                i++;
+            if (i > pos + 1 && i < 8)
+                out |= 1 << i;
+            i = pos - 1;
+            while (i >= 0 && (o >> i & 1))
+                i--;
+            if (i < pos - 1 && i >= 0)
+                out |= 1 << i;
+            OUTFLANK[pos][o6] = out;
+        }
+        for (int out = 0; out < 256; out++) {
+            uint8_t f = 0;
+            for (int i = 0; i < 8; i++) {
+                if (!(out >> i & 1))
+                    continue;
+                for (int j = min(i, pos) + 1; j < max(i, pos); j++)
+                    f |= 1 << j;
+            }
+            FLIPPED[pos][out] = f;
+        }
+    }
+    for (int f = 0; f < 256; f++) {
+        COL_DEPOSIT[f] = 0;
+        for (int i = 0; i < 8; i++)
+            if (f >> i & 1)
+                COL_DEPOSIT[f] |= 1ULL << (i * 8);
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        DIAG_MASK[sq] = ANTI_MASK[sq] = 0;
+        for (int x = 0; x < SIZE; x++) {
+            int y = x - (sq >> 3) + (sq & 7);
+            if (0 <= y && y < SIZE)
+                DIAG_MASK[sq] |= 1ULL << to_square(Point(x, y));
+            y = (sq >> 3) + (sq & 7) - x;
+            if (0 <= y && y < SIZE)
+                ANTI_MASK[sq] |= 1ULL << to_square(Point(x, y));
+        }
+        LINE_MASK[sq][0] = 0xFFULL << (sq & ~7);
+        LINE_MASK[sq][1] = 0x0101010101010101ULL << (sq & 7);
+        LINE_MASK[sq][2] = DIAG_MASK[sq];
+        LINE_MASK[sq][3] = ANTI_MASK[sq];
+        for (int d = 0; d < 4; d++)
+            LINE_POS[sq][d] = popcount(LINE_MASK[sq][d] & ((1ULL << sq) - 1));
+    }
+    return true;
+}
+const bool flip_tables_ready = init_flip_tables();
+// 第 y 行抽成 8 bits, 第 i 個 bit 是第 i 列
+inline int get_col_line(uint64_t b, int y) {
+    return (((b >> y) & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56;
+}
+// 斜線抽成 8 bits, 用格子的 y 當索引
+inline int get_diag_line(uint64_t b, uint64_t mask) {
+    return ((b & mask) * 0x0101010101010101ULL) >> 56;
+}
+inline int flip_line(int pos, int p, int o) {
+    return FLIPPED[pos][OUTFLANK[pos][(o >> 1) & 0x3F] & p];
+}
+uint64_t flip_table(int sq, uint64_t P, uint64_t O) {
+    const int x = sq >> 3, y = sq & 7;
+    uint64_t flipped = (uint64_t)flip_line(y, (P >> (x * 8)) & 0xFF, (O >> (x * 8)) & 0xFF) << (x * 8);
+    flipped |= COL_DEPOSIT[flip_line(x, get_col_line(P, y), get_col_line(O, y))] << y;
+    uint64_t mask = DIAG_MASK[sq];
+    flipped |= (flip_line(y, get_diag_line(P, mask), get_diag_line(O, mask)) * 0x0101010101010101ULL) & mask;
+    mask = ANTI_MASK[sq];
+    flipped |= (flip_line(y, get_diag_line(P, mask), get_diag_line(O, mask)) * 0x0101010101010101ULL) & mask;
+    return flipped;
+}
+#ifdef HAVE_X86_SIMD
+// 用 PEXT 直接抽出整條線, PDEP 放回去
+__attribute__((target("bmi2")))
+uint64_t flip_bmi2(int sq, uint64_t P, uint64_t O) {
+    uint64_t flipped = 0;
+    for (int d = 0; d < 4; d++) {
+        const uint64_t mask = LINE_MASK[sq][d];
+        int f = flip_line(LINE_POS[sq][d], _pext_u64(P, mask), _pext_u64(O, mask));
+        flipped |= _pdep_u64(f, mask);
+    }
+    return flipped;
+}
+#endif
+
+// PEXT/PDEP 在 AMD Zen 1/2 (family 0x19 以前) 是微碼, 一個指令幾百個 cycle, 比查表慢很多
+bool fast_pext() {
+#ifdef HAVE_X86_SIMD
+    if (!__builtin_cpu_supports("bmi2"))
+        return false;
+    unsigned eax, ebx, ecx, edx;
+    if (__builtin_cpu_is("amd") && __get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        unsigned family = (eax >> 8) & 0xF;
+        if (family == 0xF)
+            family += (eax >> 20) & 0xFF;
+        return family >= 0x19;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+// 行動力與翻棋的實作, 啟動時依 CPUID 挑最快且 CPU 支援的一組
+// needs_pext 的那幾組用 PEXT 翻棋, PEXT 慢的 CPU 自動選擇時跳過 (OTHELLO_BACKEND 還是可以強制用)
+struct Backend {
+    const char * name;
+    uint64_t (*get_moves)(uint64_t P, uint64_t O);
+    uint64_t (*flip)(int sq, uint64_t P, uint64_t O);
+    bool (*supported)();
+    bool needs_pext;
+};
+const Backend BACKENDS[] = {
+#ifdef HAVE_X86_SIMD
+    {"avx512", get_moves_avx512, flip_bmi2,
+        []() { return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("bmi2"); }, true},
+    {"avx2", get_moves_avx2, flip_bmi2,
+        []() { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"); }, true},
+    {"avx2-table", get_moves_avx2, flip_table,
+        []() { return (bool)__builtin_cpu_supports("avx2"); }, false},
+    {"bmi2", get_moves_scalar, flip_bmi2,
+        []() { return (bool)__builtin_cpu_supports("bmi2"); }, true},
+#endif
+    {"scalar", get_moves_scalar, flip_table,
+        []() { return true; }, false},
+};
+// 設定環境變數 OTHELLO_BACKEND 可以強制用某一組 (跑 benchmark 用)
+const Backend * select_backend() {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+#endif
+    const char * forced = getenv("OTHELLO_BACKEND");
+    if (forced) {
+        for (const Backend & b: BACKENDS) {
+            if (string(forced) != b.name)
+                continue;
+            if (b.supported())
+                return &b;
+            cerr << "backend " << forced << " is not supported by this CPU, using auto selection" << endl;
+            forced = NULL;
+            break;
+        }
+        if (forced)
+            cerr << "unknown backend " << forced << ", using auto selection" << endl;
+    }
+    bool pext_ok = fast_pext();
+    for (const Backend & b: BACKENDS)
+        if (b.supported() && (pext_ok || !b.needs_pext))
+            return &b;
+    return &BACKENDS[0];
+}
+const Backend * backend = select_backend();
+uint64_t (*get_moves)(uint64_t P, uint64_t O) = backend->get_moves;
+uint64_t (*flip)(int sq, uint64_t P, uint64_t O) = backend->flip;
+
+// Zobrist hashing: 每格每色一個亂數, 局面的 key 是所有棋子亂數的 xor
+uint64_t ZOBRIST[3][64];
+uint64_t ZOBRIST_FLIP[64];  // 一格由黑變白 (或白變黑)
+uint64_t ZOBRIST_SIDE;      // 輪到白子下
+uint64_t splitmix64(uint64_t & state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+bool init_zobrist() {
+    uint64_t seed = 20200628;
+    for (int sq = 0; sq < 64; sq++) {
+        ZOBRIST[0][sq] = 0;
+        ZOBRIST[1][sq] = splitmix64(seed);
+        ZOBRIST[2][sq] = splitmix64(seed);
+        ZOBRIST_FLIP[sq] = ZOBRIST[1][sq] ^ ZOBRIST[2][sq];
+    }
+    ZOBRIST_SIDE = splitmix64(seed);
+    return true;
+}
+const bool zobrist_ready = init_zobrist();
+// 沒有增量 key 時 (終局搜尋只帶兩個 bitboard) 直接從 bitboard 算 hash
+inline uint64_t hash_position(uint64_t P, uint64_t O) {
+    uint64_t h = P * 0x9E3779B97F4A7C15ULL ^ (O ^ 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
+
+// 用二維陣列存的舊版棋盤, 留著當作位元棋盤的對照
+class ArrayOthelloBoard {
+private:
+    enum SPOT_STATE {
+        EMPTY = 0,
+        BLACK = 1,
+        WHITE = 2
+    };
+    static const int SIZE = 8;
+    const std::array<Point, 8> directions{{
+        Point(-1, -1), Point(-1, 0), Point(-1, 1),
+        Point(0, -1), /*{0, 0}, */Point(0, 1),
+        Point(1, -1), Point(1, 0), Point(1, 1)
+    }};
+    array<array<int, SIZE>, SIZE> board;
+    vector<Point> next_valid_spots;
+    array<int, 3> disc_count;
+    int cur_player;
+    bool done;
+    int winner;
+private:
+    // 下一手是黑子還白子下
+    int get_next_player(int player) const {
+        return 3 - player;
+    }
+    // 點是否在棋盤內
+    bool is_spot_on_board(Point p) const {
+        return 0 <= p.x && p.x < SIZE && 0 <= p.y && p.y < SIZE;
+    }
+    // 這個點是什麼棋(黑白空)
+    int get_disc(Point p) const {
+        return board[p.x][p.y];
+    }
+    // 設置這格是什麼棋
+    void set_disc(Point p, int disc) {
+        board[p.x][p.y] = disc;
+    }
+    // 
+    bool is_disc_at(Point p, int disc) const {
+        if (!is_spot_on_board(p))
+            return false;
+        if (get_disc(p) != disc)
+            return false;
+        return true;
+    }
+    // 判斷這步棋能不能下(判斷棋布合法)
+    bool is_spot_valid(Point center) const {
+        if (get_disc(center) != EMPTY)
+            return false;
+        for (Point dir: directions) {
+            // Move along the direction while testing.
+            Point p = center + dir;
+            if (!is_disc_at(p, get_next_player(cur_player)))
+                continue;
+            p = p + dir;
+            while (is_spot_on_board(p) && get_disc(p) != EMPTY) {
+                if (is_disc_at(p, cur_player))
+                    return true;
+                p = p + dir;
+            }
+        }
+        return false;
+    }
+    // 更新棋盤
+    void flip_discs(Point center) {
+        for (Point dir: directions) {
+            // Move along the direction while testing.
+            Point p = center + dir;
+            if (!is_disc_at(p, get_next_player(cur_player)))
+                continue;
+            std::vector<Point> discs({p});
+            p = p + dir;
+            while (is_spot_on_board(p) && get_disc(p) != EMPTY) {
+                if (is_disc_at(p, cur_player)) {
+                    for (Point s: discs) {
+                        set_disc(s, cur_player);
+                    }
+                    disc_count[cur_player] += discs.size();
+                    disc_count[get_next_player(cur_player)] -= discs.size();
+                    break;
+                }
+                discs.push_back(p);
+                p = p + dir;
+            }
+        }
+    }
+public:
+    ArrayOthelloBoard(array<array<int, SIZE>, SIZE> board, vector<Point> next_valid_spots, int cur_player)
+    :board(board), next_valid_spots(next_valid_spots), cur_player(cur_player) {
+        disc_count[EMPTY] = 0;
+        disc_count[BLACK] = 0;
+        disc_count[WHITE] = 0;
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                if(board[i][j] == BLACK)
+                    disc_count[BLACK] ++;
+                else if(board[i][j] == WHITE)
+                    disc_count[WHITE] ++;
+            }
+        }
+        done = false;
+        winner = -1;
+    }
+    ArrayOthelloBoard(const ArrayOthelloBoard & round){
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                board[i][j] = round.board[i][j];
+            }
+        }
+        next_valid_spots = round.next_valid_spots;
+        cur_player = round.cur_player;
+        disc_count[EMPTY] = round.disc_count[EMPTY];
+        disc_count[BLACK] = round.disc_count[BLACK];
+        disc_count[WHITE] = round.disc_count[WHITE];
+        done = false;
+        winner = -1;
+    }
+    // 下這步棋後對手可下的地方(已經排除掉不合法棋步)
+    vector<Point> get_valid_spots() const {
+        vector<Point> valid_spots;
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                Point p = Point(i, j);
+                if (board[i][j] != EMPTY)
+                    continue;
+                if (is_spot_valid(p))
+                    valid_spots.push_back(p);
+            }
+        }
+        return valid_spots;
+    }
+    // 下這步棋
+    bool put_disc(Point p) {
+        if(!is_spot_valid(p)) {
+            winner = get_next_player(cur_player);
+            done = true;
+            return false;
+        }
+        set_disc(p, cur_player);
+        disc_count[cur_player]++;
+        disc_count[EMPTY]--;
+        flip_discs(p);
+        // Give control to the other player.
+        cur_player = get_next_player(cur_player);
+        next_valid_spots = get_valid_spots();
+        return true;
+    }
+    //
+    vector<Point> get_cur_next_valid_spots(){
+        return next_valid_spots;
+    }
+    //
+    array<array<int, SIZE>, SIZE> get_cur_board(){
+        return board;
+    }
+    //
+    int get_cur_player(){
+        return cur_player;
+    }
+    //
+    int get_gap(){
+        return disc_count[cur_player] - disc_count[get_next_player(cur_player)];
+    }
+    int get_dics_num(){
+        return disc_count[cur_player] + disc_count[get_next_player(cur_player)];
+    }
+    bool get_done(){
+        return done;
+    }
+};
+
+// 固定容量的走步列表, 放在 stack 上不用配置記憶體, 每步附一個排序用的分數
+const int MAX_MOVES = 64;
+struct Move {
+    int sq;
+    int score;
+};
+struct MoveList {
+    array<Move, MAX_MOVES> moves;
+    int size;
+    MoveList() : size(0) {}
+    // 把可下位置的 bitboard 展開
+    explicit MoveList(uint64_t mask) : size(0) {
+        for (; mask; mask &= mask - 1)
+            moves[size++] = {first_square(mask), 0};
+    }
+    Move & operator[](int i) {
+        return moves[i];
+    }
+    Move * begin() {
+        return moves.data();
+    }
+    Move * end() {
+        return moves.data() + size;
+    }
+};
+
+// 悔棋需要的資訊, 搜尋時每一層存一個
+struct MoveUndo {
+    int sq;
+    uint64_t flipped;
+    uint64_t next_valid_spots;
+    uint64_t key;
+};
+
+// 位元棋盤: 雙方各一個 uint64_t (終局搜尋傳來傳去的只有這 16 bytes 的 P, O),
+// 加上合法位置, 雜湊值, 輪到誰和勝負, 整個物件 48 bytes, 複製不用配置記憶體
+class OthelloBoard {
+private:
+    enum SPOT_STATE {
+        EMPTY = 0,
+        BLACK = 1,
+        WHITE = 2
+    };
+    static const int SIZE = 8;
+    uint64_t me;    // 下一手玩家的棋子
+    uint64_t opp;   // 對手的棋子
+    uint64_t next_valid_spots;
+    uint64_t key;   // Zobrist key, 下子時增量更新
+    int cur_player;
+    bool done;
+    int winner;
+private:
+    // 下一手是黑子還白子下
+    int get_next_player(int player) const {
+        return 3 - player;
+    }
+    // 從頭算 Zobrist key
+    uint64_t compute_key() const {
+        uint64_t k = cur_player == WHITE ? ZOBRIST_SIDE : 0;
+        for (uint64_t b = me; b; b &= b - 1)
+            k ^= ZOBRIST[cur_player][first_square(b)];
+        for (uint64_t b = opp; b; b &= b - 1)
+            k ^= ZOBRIST[get_next_player(cur_player)][first_square(b)];
+        return k;
+    }
+    // 這個點是什麼棋(黑白空)
+    int get_disc(Point p) const {
+        uint64_t m = 1ULL << to_square(p);
+        if (me & m)
+            return cur_player;
+        if (opp & m)
+            return get_next_player(cur_player);
+        return EMPTY;
+    }
+    // 判斷這步棋能不能下(判斷棋布合法)
+    bool is_spot_valid(Point center) const {
+        if ((me | opp) & (1ULL << to_square(center)))
+            return false;
+        return flip(to_square(center), me, opp) != 0;
+    }
+public:
+    OthelloBoard(array<array<int, SIZE>, SIZE> board, vector<Point> next_valid_spots, int cur_player)
+    :me(0), opp(0), next_valid_spots(0), cur_player(cur_player) {
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                if (board[i][j] == cur_player)
+                    me |= 1ULL << to_square(Point(i, j));
+                else if (board[i][j] == get_next_player(cur_player))
+                    opp |= 1ULL << to_square(Point(i, j));
+            }
+        }
+        for (Point p: next_valid_spots)
+            this->next_valid_spots |= 1ULL << to_square(p);
+        key = compute_key();
+        done = false;
+        winner = -1;
+    }
+    // 下這步棋後對手可下的地方(已經排除掉不合法棋步)
+    vector<Point> get_valid_spots() const {
+        vector<Point> valid_spots;
+        for (uint64_t moves = get_moves(me, opp); moves; moves &= moves - 1)
+            valid_spots.push_back(to_point(first_square(moves)));
+        return valid_spots;
+    }
+    // 下這步棋
+    bool put_disc(Point p) {
+        if(!is_spot_valid(p)) {
+            winner = get_next_player(cur_player);
+            done = true;
+            return false;
+        }
+        MoveUndo undo;
+        make_move(to_square(p), undo);
+        return true;
+    }
+    // 直接在這個棋盤上下 sq (不檢查合法), 還原用的資訊存進 undo
+    void make_move(int sq, MoveUndo & undo) {
+        undo.sq = sq;
+        undo.flipped = flip(sq, me, opp);
+        undo.next_valid_spots = next_valid_spots;
+        undo.key = key;
+        me ^= undo.flipped | (1ULL << sq);
+        opp ^= undo.flipped;
+        key ^= ZOBRIST[cur_player][sq] ^ ZOBRIST_SIDE;
+        for (uint64_t b = undo.flipped; b; b &= b - 1)
+            key ^= ZOBRIST_FLIP[first_square(b)];
+        // Give control to the other player.
+        swap(me, opp);
+        cur_player = get_next_player(cur_player);
+        next_valid_spots = get_moves(me, opp);
+#ifdef DEBUG_CHECK
+        assert(key == compute_key());
+#endif
+    }
+    // 還原 make_move
+    void undo_move(const MoveUndo & undo) {
+        cur_player = get_next_player(cur_player);
+        swap(me, opp);
+        me ^= undo.flipped | (1ULL << undo.sq);
+        opp ^= undo.flipped;
+        next_valid_spots = undo.next_valid_spots;
+        key = undo.key;
+#ifdef DEBUG_CHECK
+        assert(key == compute_key());
+#endif
+    }
+    // 沒地方下, 換對手
+    void make_pass(MoveUndo & undo) {
+        undo.next_valid_spots = next_valid_spots;
+        undo.key = key;
+        swap(me, opp);
+        cur_player = get_next_player(cur_player);
+        key ^= ZOBRIST_SIDE;
+        next_valid_spots = get_moves(me, opp);
+    }
+    void undo_pass(const MoveUndo & undo) {
+        swap(me, opp);
+        cur_player = get_next_player(cur_player);
+        next_valid_spots = undo.next_valid_spots;
+        key = undo.key;
+    }
+    // 對手有沒有地方下 (自己也沒地方下就是終局)
+    bool opponent_can_move(){
+        return get_moves(opp, me) != 0;
+    }
+    //
+    vector<Point> get_cur_next_valid_spots(){
+        vector<Point> valid_spots;
+        for (uint64_t moves = next_valid_spots; moves; moves &= moves - 1)
+            valid_spots.push_back(to_point(first_square(moves)));
+        return valid_spots;
+    }
+    //
+    array<array<int, SIZE>, SIZE> get_cur_board(){
+        array<array<int, SIZE>, SIZE> board;
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                board[i][j] = get_disc(Point(i, j));
+            }
+        }
+        return board;
+    }
+    //
+    int get_cur_player(){
+        return cur_player;
+    }
+    // 下一手玩家/對手的棋子, 可下位置
+    uint64_t get_player_discs(){
+        return me;
+    }
+    uint64_t get_opponent_discs(){
+        return opp;
+    }
+    uint64_t get_valid_mask(){
+        return next_valid_spots;
+    }
+    uint64_t get_key(){
+        return key;
+    }
+    //
+    int get_gap(){
+        return popcount(me) - popcount(opp);
+    }
+    int get_dics_num(){
+        return popcount(me | opp);
+    }
+    bool get_done(){
+        return done;
+    }
+};
+
+// 讀整數環境變數, 沒設定時用預設值
+int get_env_int(const char * name, int default_value) {
+    const char * value = getenv(name);
+    return value ? atoi(value) : default_value;
+}
+
+// 讀逗號分隔的整數列表環境變數
+vector<int> get_env_list(const char * name, vector<int> default_value) {
+    const char * value = getenv(name);
+    if (!value)
+        return default_value;
+    vector<int> list;
+    string item;
+    for (const char * c = value; ; c++) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty())
+                list.push_back(atoi(item.c_str()));
+            item.clear();
+            if (*c == '\0')
+                break;
+        } else {
+            item += *c;
+        }
+    }
+    return list;
+}
+
+// 搜尋演算法, 由環境變數 OTHELLO_SEARCH 選
+enum SEARCH_MODE {
+    SEARCH_PVS = 0,
+    SEARCH_MINIMAX = 1, // 舊的兩邊分開寫的 minimax, 留著對照
+    SEARCH_MTDF = 2     // MTD(f): 只用 null window 逼近根節點的值
+};
+int get_search_mode() {
+    const char * mode = getenv("OTHELLO_SEARCH");
+    if (mode && string(mode) == "minimax")
+        return SEARCH_MINIMAX;
+    if (mode && string(mode) == "mtdf")
+        return SEARCH_MTDF;
+    return SEARCH_PVS;
+}
+// 多執行緒的分工方式, 由環境變數 OTHELLO_PARALLEL 設定
+enum PARALLEL_MODE {
+    PARALLEL_LAZY = 0,  // Lazy SMP: 每個執行緒都搜整棵樹, 只靠置換表互相幫忙
+    PARALLEL_ROOT = 1,  // root 的每一步分給不同的執行緒
+    PARALLEL_ABDADA = 2 // 每個執行緒都搜整棵樹, 別的執行緒正在搜的子節點先跳過
+};
+int get_parallel_mode() {
+    const char * mode = getenv("OTHELLO_PARALLEL");
+    if (mode && string(mode) == "root")
+        return PARALLEL_ROOT;
+    if (mode && string(mode) == "abdada")
+        return PARALLEL_ABDADA;
+    return PARALLEL_LAZY;
+}
+
+// 置換表: 記錄搜過的局面 (key, 剩餘深度, 上下界, 分數, 最佳步)
+enum TT_BOUND {
+    TT_NONE = 0,
+    TT_EXACT = 1,
+    TT_LOWER = 2,   // 真正的值 >= score
+    TT_UPPER = 3    // 真正的值 <= score
+};
+const int TT_NO_MOVE = 64;
+struct TTEntry {
+    uint64_t key;
+    int32_t score;
+    int8_t depth;
+    uint8_t bound;
+    uint8_t move;
+    uint8_t age;
+};
+// 表裡一格存兩個 64 位元: data 是打包的 score/depth/bound/move/age, check = key ^ data
+// 不用鎖, 多個執行緒同時寫同一格時可能拿到一半新一半舊, 這時 check ^ data 對不上 key, 當作沒找到
+struct TTSlot {
+    atomic<uint64_t> check;
+    atomic<uint64_t> data;
+    void load(TTEntry & entry) const {
+        uint64_t d = data.load(memory_order_relaxed);
+        uint64_t c = check.load(memory_order_relaxed);
+        entry.key = c ^ d;
+        entry.score = (int32_t)(uint32_t)d;
+        entry.depth = (int8_t)(d >> 32);
+        entry.bound = (uint8_t)(d >> 40);
+        entry.move = (uint8_t)(d >> 48);
+        entry.age = (uint8_t)(d >> 56);
+    }
+    void save(const TTEntry & entry) {
+        uint64_t d = (uint64_t)(uint32_t)entry.score | (uint64_t)(uint8_t)entry.depth << 32
+            | (uint64_t)entry.bound << 40 | (uint64_t)entry.move << 48 | (uint64_t)entry.age << 56;
+        data.store(d, memory_order_relaxed);
+        check.store(entry.key ^ d, memory_order_relaxed);
+    }
+};
+// 每個 bucket 兩格: 一格保留較深的結果, 一格總是覆蓋, 兩個 bucket 剛好一條 cache line
+struct alignas(32) TTBucket {
+    TTSlot deep;
+    TTSlot recent;
+};
+class TranspositionTable {
+private:
+    void * memory;      // calloc 拿到的整塊記憶體, buckets 是裡面對齊 64 bytes 的位置
+    TTBucket * buckets;
+    uint64_t mask;
+    uint8_t age;
+    // ABDADA: 每個 bucket 一個計數, 記錄有幾個執行緒正在搜落在這個 bucket 的局面
+    unique_ptr<atomic<uint8_t>[]> busy;
+public:
+    TranspositionTable(int size_mb) : memory(NULL), buckets(NULL), age(0) {
+        resize(size_mb);
+    }
+    ~TranspositionTable() {
+        free(memory);
+    }
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable & operator=(const TranspositionTable &) = delete;
+    // 大小以 MB 為單位, 取不超過的 2 的冪次個 bucket; 配置不到就減半再試
+    // 全部是 0 的格子讀出來就是 TT_NONE (空的), calloc 的記憶體不用再清, 大的表是用到才真的配置頁面
+    void resize(int size_mb) {
+        uint64_t n = 1;
+        while (n * 2 * sizeof(TTBucket) <= (uint64_t)max(size_mb, 1) << 20)
+            n *= 2;
+        uint64_t wanted = n;
+        free(memory);
+        memory = NULL;
+        busy.reset();
+        for (; n >= 1; n /= 2) {
+            memory = calloc(n * sizeof(TTBucket) + 63, 1);
+            busy.reset(new (nothrow) atomic<uint8_t>[n]());
+            if (memory && busy)
+                break;
+            free(memory);
+            memory = NULL;
+            busy.reset();
+        }
+        if (!memory) {
+            cerr << "transposition table: out of memory" << endl;
+            abort();
+        }
+        if (n < wanted)
+            cerr << "transposition table: only " << ((n * sizeof(TTBucket)) >> 20) << " MB available" << endl;
+        buckets = reinterpret_cast<TTBucket *>(((uintptr_t)memory + 63) & ~(uintptr_t)63);
+        // atomic 要先建構才能用; 不加 () 是預設初始化, 不會寫記憶體, 內容還是 calloc 的 0
+        for (uint64_t i = 0; i < n; i++)
+            new (&buckets[i]) TTBucket;
+        mask = n - 1;
+        age = 0;
+    }
+    void clear() {
+        const TTEntry empty = {0, 0, 0, TT_NONE, TT_NO_MOVE, 0};
+        for (uint64_t i = 0; i <= mask; i++) {
+            buckets[i].deep.save(empty);
+            buckets[i].recent.save(empty);
+            busy[i].store(0, memory_order_relaxed);
+        }
+    }
+    // 開始/結束搜一個局面, 和別的局面共用 bucket 時只是多跳過一些, 不影響結果
+    void enter(uint64_t key) {
+        busy[key & mask].fetch_add(1, memory_order_relaxed);
+    }
+    void leave(uint64_t key) {
+        busy[key & mask].fetch_sub(1, memory_order_relaxed);
+    }
+    bool is_busy(uint64_t key) const {
+        return busy[key & mask].load(memory_order_relaxed) != 0;
+    }
+    // 每次新的搜尋呼叫一次, 舊的結果優先被覆蓋
+    void new_search() {
+        age++;
+    }
+    // 找到就回傳 true 並填入 entry
+    bool probe(uint64_t key, TTEntry & entry) const {
+        const TTBucket & b = buckets[key & mask];
+        b.deep.load(entry);
+        if (entry.key == key && entry.bound != TT_NONE)
+            return true;
+        b.recent.load(entry);
+        return entry.key == key && entry.bound != TT_NONE;
+    }
+    void store(uint64_t key, int depth, int bound, int score, int move) {
+        TTBucket & b = buckets[key & mask];
+        TTEntry deep;
+        b.deep.load(deep);
+        TTEntry entry = {key, score, (int8_t)depth, (uint8_t)bound, (uint8_t)move, age};
+        if (deep.key == key || depth >= deep.depth || deep.age != age) {
+            if (move == TT_NO_MOVE && deep.key == key)
+                entry.move = deep.move;
+            b.deep.save(entry);
+        } else {
+            b.recent.save(entry);
+        }
+    }
+};
+
+// 所有搜尋共用一個置換表, 大小 (MB) 由環境變數 OTHELLO_HASH_MB 設定
+TranspositionTable & shared_tt() {
+    static TranspositionTable tt(get_env_int("OTHELLO_HASH_MB", 64));
+    return tt;
+}
+
+// 固定的工作執行緒: run(job) 讓每個執行緒 (包括呼叫的, 編號 0) 各跑一次 job(編號), 全部跑完才回傳
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex m;
+    condition_variable start_cv, done_cv;
+    function<void(int)> job;
+    int generation;
+    int running;
+    bool quit;
+    void loop(int id) {
+        int seen = 0;
+        while (true) {
+            function<void(int)> f;
+            {
+                unique_lock<mutex> lock(m);
+                start_cv.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+                f = job;
+            }
+            f(id);
+            lock_guard<mutex> lock(m);
+            if (--running == 0)
+                done_cv.notify_one();
+        }
+    }
+public:
+    explicit ThreadPool(int n_threads) : generation(0), running(0), quit(false) {
+        for (int id = 1; id < n_threads; id++)
+            workers.emplace_back([this, id] { loop(id); });
+    }
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            quit = true;
+        }
+        start_cv.notify_all();
+        for (thread & t: workers)
+            t.join();
+    }
+    int size() const {
+        return workers.size() + 1;
+    }
+    void run(const function<void(int)> & f) {
+        {
+            lock_guard<mutex> lock(m);
+            job = f;
+            running = workers.size();
+            generation++;
+        }
+        start_cv.notify_all();
+        f(0);
+        unique_lock<mutex> lock(m);
+        done_cv.wait(lock, [&] { return running == 0; });
+    }
+};
+// 執行緒數由環境變數 OTHELLO_THREADS 設定, 預設是 CPU 核心數
+ThreadPool & thread_pool() {
+    static ThreadPool pool(max(get_env_int("OTHELLO_THREADS", thread::hardware_concurrency()), 1));
+    return pool;
+}
+
+// YBWC 的分割點: 一個節點的第一步搜完還沒被剪掉, 剩下的步讓閒著的執行緒一起搜
+struct SplitPoint {
+    uint64_t P, O;
+    int empties, beta;
+    MoveList moves;
+    SplitPoint * parent;    // 外層的分割點, 外層被剪掉時這裡的搜尋也要停
+    mutex m;                // 更新 alpha, best_value, best_move 時要鎖
+    atomic<int> next;       // 下一個要搜的步
+    atomic<int> alpha;
+    int best_value, best_move;
+    atomic<int> helpers;    // 加入幫忙, 還沒搜完的其他執行緒數
+    atomic<bool> cutoff;
+    atomic<bool> stopped;   // 有執行緒時間到 (或被取消) 丟下拿走的步, best_value 不完整
+};
+// 閒著的執行緒在這裡睡: 有新的分割點, 分割點的 helper 搜完, 或終局搜尋結束/被取消時叫醒
+// 先記下 generation 再去找工作, 沒找到就等 generation 變, 中間的通知不會漏掉
+struct IdleSignal {
+    mutex m;
+    condition_variable cv;
+    atomic<int> generation;
+    IdleSignal() : generation(0) {}
+    void notify() {
+        {
+            lock_guard<mutex> lock(m);
+            generation++;
+        }
+        cv.notify_all();
+    }
+    template <class Pred> void wait(int seen, Pred done) {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [&] { return generation != seen || done(); });
+    }
+};
+// 每個執行緒一個, 放自己開的分割點: 自己從底部放入/拿走 (最深的先結束)
+// 其他執行緒從頂端 (最靠近根, 剩下的工作最多) 找還有步沒搜的加入; 同一個分割點可以有好幾個執行緒一起搜
+// 分割點和堆疊都是固定大小的陣列, 搜尋中不配置記憶體
+const int MAX_SPLITS = 64;
+class WorkDeque {
+private:
+    mutex m;
+    array<SplitPoint *, MAX_SPLITS> items;
+    int size;
+public:
+    WorkDeque() : size(0) {}
+    void push(SplitPoint * sp, IdleSignal & idle) {
+        {
+            lock_guard<mutex> lock(m);
+            items[size++] = sp;
+        }
+        idle.notify();
+    }
+    // 拿走之後就沒有執行緒能再加入
+    void pop() {
+        lock_guard<mutex> lock(m);
+        size--;
+    }
+    // 找一個還有步沒搜的分割點加入 (helpers 加一), 沒有就回傳 NULL
+    // under 不是 NULL 時只找開在 under 底下的 (parent 一路往上會碰到 under)
+    SplitPoint * steal(const SplitPoint * under = NULL) {
+        lock_guard<mutex> lock(m);
+        for (int i = 0; i < size; i++) {
+            SplitPoint * sp = items[i];
+            if (sp->cutoff || sp->next >= sp->moves.size)
+                continue;
+            const SplitPoint * p = sp->parent;
+            while (under && p && p != under)
+                p = p->parent;
+            if (under && !p)
+                continue;
+            sp->helpers++;
+            return sp;
+        }
+        return NULL;
+    }
+};
+
+// Multi-ProbCut: 用淺層搜尋的分數 v 預測深層搜尋的分數 a * v + b, 誤差標準差 sigma
+// 依盤面棋子數分階段, 每個深度一組參數 (a = 0 表示不剪), 參數由 probcut_fit.cpp 算出
+// 評估函數 (穩定子, 終局分數的比例) 改了就要重新擬合
+struct ProbCutParam {
+    double a, b, sigma;
+};
+const int PROBCUT_PHASES = 8;
+const int PROBCUT_MIN_DEPTH = 3;
+const int PROBCUT_MAX_DEPTH = 12;
+// 淺層搜尋的深度, 和深層同奇偶 (評估函數在奇偶層的基準不同)
+const int PROBCUT_SHALLOW[PROBCUT_MAX_DEPTH + 1] = {0, 0, 0, 1, 2, 1, 2, 3, 4, 3, 4, 5, 6};
+const ProbCutParam PROBCUT_PARAMS[PROBCUT_PHASES][PROBCUT_MAX_DEPTH + 1] = {
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.111, 6.9, 72.3}, {1.456, -19.9, 90.4}, {0.000, 0.0, 0.0}, {1.754, -38.8, 88.6}, {1.111, -4.0, 58.9}, {1.102, 8.1, 49.7}, {1.148, -0.3, 68.8}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.057, 3.9, 61.4}, {1.045, 7.4, 70.7}, {1.051, -2.4, 72.1}, {1.045, 15.3, 81.9}, {1.045, -0.5, 67.7}, {1.052, 5.3, 85.1}, {1.107, -11.1, 142.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.028, 9.1, 79.8}, {1.022, 8.4, 97.1}, {1.060, 8.5, 130.1}, {1.063, 2.7, 139.9}, {1.084, -17.1, 143.7}, {1.114, -38.3, 178.4}, {1.239, -86.2, 238.4}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.028, 25.3, 119.0}, {1.028, 7.5, 115.9}, {1.098, 10.3, 183.0}, {1.089, -26.1, 168.3}, {1.094, -5.9, 162.4}, {1.118, -56.0, 188.0}, {1.191, -47.0, 257.9}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.034, 27.8, 160.4}, {1.039, 3.7, 146.9}, {1.036, -19.4, 230.7}, {1.081, -18.8, 185.3}, {1.082, -5.2, 148.3}, {1.112, -11.7, 167.8}, {1.153, -24.2, 285.4}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.045, 16.1, 146.7}, {1.039, 10.7, 132.1}, {1.107, -6.5, 205.5}, {1.093, 3.3, 184.5}, {1.107, 36.3, 181.4}, {1.112, 9.4, 184.0}, {1.197, 54.0, 279.4}, {1.177, -14.7, 343.5}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.038, 29.1, 154.5}, {1.039, 23.3, 169.3}, {1.087, 17.7, 250.4}, {1.115, 28.5, 218.8}, {1.107, 42.1, 198.1}, {1.132, 8.3, 233.6}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+    {{0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {1.005, 14.7, 110.4}, {1.023, 5.1, 112.7}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}, {0.000, 0.0, 0.0}},
+};
+inline int get_probcut_phase(int discs) {
+    return (discs - 4) / 8;
+}
+
+class AI {
+private:
+    // state value
+    int state_value[8][8] = {
+        500, -25, 10, 5, 5, 10, -25, 500,
+        -25, -50, -5, 1, 1, -5, -50, -25,
+        10, -5, 2, 2, 2, 2, -5, 10,
+        5, 1, 2, -3, -3, 2, 1, 5,
+        5, 1, 2, -3, -3, 2, 1, 5,
+        10, -5, 2, 2, 2, 2, -5, 10,
+        -25, -50, -5, 1, 1, -5, -50, -25,
+        500 , -25, 10, 5, 5, 10, -25, 500,
+    };
+    // 這一輪 iterative deepening 搜到幾層
+    int limit_depth = 5;
+    // 每一步的時間 (ms), 由環境變數 OTHELLO_TIME_MS 設定
+    int time_limit_ms;
+    chrono::steady_clock::time_point start_time;
+    bool stop;
+    long long nodes;
+    int search_mode;
+    int parallel_mode;
+    // ABDADA: 剩餘深度 >= ABDADA_MIN_DEPTH 的節點才標記/跳過
+    static const int ABDADA_MIN_DEPTH = 3;
+    bool abdada;
+    // OTHELLO_VERBOSE=1 時把每一輪的結果印到 stderr
+    bool verbose;
+    // anytime 輸出: 目前最好的一步有變就呼叫
+    function<void(Point)> report_move;
+    int reported_sq;
+    // aspiration window 每次放寬的寬度, 由環境變數 OTHELLO_ASPIRATION 設定 (例如 "5,25,100", "0" 表示不用)
+    vector<int> aspiration_widths;
+    array<int, SIZE * SIZE + 1> iteration_score;
+    long long aspiration_searches, fail_lows, fail_highs;
+    long long mtdf_passes;
+    long long probcut_cuts;
+    // Multi-ProbCut 開關 (OTHELLO_PROBCUT) 與門檻 t (OTHELLO_PROBCUT_T, 單位 1/100 sigma)
+    bool probcut;
+    double probcut_t;
+    // OTHELLO_PROBCUT_LOG=檔名 時記錄 (棋子數, 深度, 淺層分數, 深層分數) 給 probcut_fit 用
+    ofstream probcut_log;
+    bool logging;
+    // 每顆穩定子的分數
+    static const int STABILITY_WEIGHT = 20;
+    // 剩下幾個空格以內改用精確的終局搜尋 (OTHELLO_EXACT_EMPTIES)
+    int exact_empties;
+    // 再多幾格以內只算勝/和/敗 (OTHELLO_WLD_EMPTIES)
+    int wld_empties;
+    static const int END_GAME_SCALE = 10000;
+    // 終局搜尋: 空格串成雙向串列 (EMPTY_HEAD 是頭), 依 state_value 由好到壞排
+    static const int EMPTY_HEAD = SIZE * SIZE;
+    static const int SOLVE_TT_EMPTIES = 8;        // 空格數以上才查置換表
+    static const int FASTEST_FIRST_EMPTIES = 7;   // 空格數以上才用對手行動力排序
+    static const int STABILITY_EMPTIES = 7;       // 空格數以上才做穩定子剪枝
+    array<int, SIZE * SIZE + 1> empty_next, empty_prev;
+    // 走步排序: 每層兩個 killer, 每個玩家每格一個 history 分數
+    static const int PRIOR_WEIGHT = 4;
+    array<array<int, 2>, SIZE * SIZE> killers;
+    array<array<int, SIZE * SIZE>, 3> history;
+    long long cutoffs, first_move_cutoffs;
+    // 每一層的悔棋資訊
+    array<MoveUndo, SIZE * SIZE> undo_stack;
+    TranspositionTable & tt;
+    // root 平行搜尋: 每個工作執行緒一個 helper (自己的盤面, killer, history), 置換表共用
+    ThreadPool & pool;
+    vector<unique_ptr<OthelloBoard>> helper_rounds;
+    vector<unique_ptr<AI>> helpers;
+    // 平行搜尋時 root 的共用狀態, 由 root_mutex 保護
+    mutex root_mutex;
+    int root_best_score, root_best_idx, root_next;
+    // 有一步 fail high 時叫所有執行緒停下來; helper 指向主執行緒的
+    atomic<bool> abort_search;
+    atomic<bool> * abort_flag;
+    // helper 指向主執行緒, 主執行緒指向自己
+    AI * master;
+    // ponder: 在對手的時間先搜預測的局面, 這時不看時間; cancelled 是猜錯時叫停
+    atomic<bool> pondering;
+    atomic<bool> cancelled;
+    static const int PONDER_MIDGAME_DEPTH = 8;
+    // YBWC: 終局搜尋在空格數 >= split_empties (預設 SPLIT_EMPTIES) 的節點分割, workers 是主執行緒和所有 helper
+    static const int SPLIT_EMPTIES = 12;
+    int split_empties;
+    bool ybwc;
+    array<SplitPoint, MAX_SPLITS> split_points;
+    int n_split_points;
+    SplitPoint * active_split;      // 目前所在最內層的分割點
+    WorkDeque work;
+    vector<AI *> workers;
+    atomic<bool> ybwc_done;
+    IdleSignal idle;                // 用主執行緒 (master) 的
+    // informations
+    OthelloBoard & first_round;
+    array<array<int, SIZE>, SIZE> board;
+    MoveList next_valid_spots;
+    int cur_player;
+public:
+    AI(OthelloBoard & first_round):time_limit_ms(get_env_int("OTHELLO_TIME_MS", 1000)), stop(false), nodes(0),
+        search_mode(get_search_mode()), parallel_mode(get_parallel_mode()), abdada(false), verbose(get_env_int("OTHELLO_VERBOSE", 0)),
+        reported_sq(-1), iteration_score{}, aspiration_searches(0), fail_lows(0), fail_highs(0), mtdf_passes(0), probcut_cuts(0),
+        tt(shared_tt()), pool(thread_pool()), abort_search(false), abort_flag(&abort_search),
+        master(this), pondering(false), cancelled(false), split_empties(SPLIT_EMPTIES), ybwc(false), n_split_points(0), active_split(NULL), ybwc_done(false), first_round(first_round) {
+        load_position();
+        exact_empties = get_env_int("OTHELLO_EXACT_EMPTIES", 16);
+        wld_empties = get_env_int("OTHELLO_WLD_EMPTIES", 19);
+        probcut = get_env_int("OTHELLO_PROBCUT", 1);
+        probcut_t = get_env_int("OTHELLO_PROBCUT_T", 150) / 100.0;
+        if(getenv("OTHELLO_PROBCUT_LOG"))
+            probcut_log.open(getenv("OTHELLO_PROBCUT_LOG"), ios::app);
+        logging = false;
+        aspiration_widths = get_env_list("OTHELLO_ASPIRATION", {5, 25, 100});
+        if(!aspiration_widths.empty() && aspiration_widths[0] <= 0)
+            aspiration_widths.clear();
+        for(array<int, SIZE * SIZE> & hist: history)
+            hist.fill(0);
+        age_history();
+    }
+    // 開始 ponder 時 on = true, 猜中時設成 false, 之後照一般的時間限制 (從開始 ponder 算起) 搜完
+    void set_pondering(bool on){
+        pondering = on;
+    }
+    // 猜錯: 叫正在 ponder 的搜尋 (包括 helper) 停下來, 搜尋結束後要 reset_cancel
+    void cancel(){
+        cancelled = true;
+        idle.notify();
+    }
+    void reset_cancel(){
+        cancelled = false;
+        pondering = false;
+    }
+    // 預測 round 的玩家會下哪一步: 置換表裡的最佳步, 沒有就用 state_value 最高的
+    int predict_reply(OthelloBoard & round){
+        MoveList moves(round.get_valid_mask());
+        TTEntry entry;
+        if(tt.probe(round.get_key(), entry)){
+            for(Move & m: moves)
+                if(m.sq == entry.move) return m.sq;
+        }
+        int best_sq = moves[0].sq;
+        for(Move & m: moves)
+            if(state_value[m.sq >> 3][m.sq & 7] > state_value[best_sq >> 3][best_sq & 7]) best_sq = m.sq;
+        return best_sq;
+    }
+    // first_round 換成新的局面後呼叫, 置換表和 history 留著
+    void load_position(){
+        board = first_round.get_cur_board();
+        next_valid_spots = MoveList(first_round.get_valid_mask());
+        cur_player = first_round.get_cur_player();
+    }
+    // 盤面分數: discs 佔的格子的 state_value 總和
+    int state_score(uint64_t discs){
+        int state = 0;
+        for(; discs; discs &= discs - 1){
+            int sq = first_square(discs);
+            state += state_value[sq >> 3][sq & 7];
+        }
+        return state;
+    }
+    // state value, 站在剛下完這一手的玩家角度
+    int evaluation(OthelloBoard & round){
+        int value = 0;
+
+        // 落下這個點後盤面分數
+        int state = 0;
+        state = state_score(round.get_opponent_discs()) - state_score(round.get_player_discs());
+        // 對方行動力
+        int mob = 0;
+        mob = -popcount(round.get_valid_mask());
+        // 下這個點後對方與自己的棋子數目差
+        int gap = 0;
+        gap = -round.get_gap();
+        // 穩定度
+        int sta = 0;
+        sta = count_stability(round);
+
+        value = state + mob * 10 + gap + sta * STABILITY_WEIGHT;
+        return value;
+    }
+    // stability: 剛下完的一方 (round 的對手) 比 round 現在的玩家多幾顆穩定子
+    int count_stability(OthelloBoard & round){
+        uint64_t P = round.get_player_discs(), O = round.get_opponent_discs();
+        // 沒有角的時候穩定子只能靠四個方向都下滿, 中盤幾乎不會發生, 省下來
+        if(!((P | O) & 0x8100000000000081ULL)) return 0;
+        return popcount(get_stable(O, P)) - popcount(get_stable(P, O));
+    }
+    // close end game: 雙方都不能下, 直接用最後的棋子差, 放大到比任何盤面分數都重要
+    int end_game_value(OthelloBoard & round){
+        return final_score(round.get_player_discs(), round.get_opponent_discs()) * END_GAME_SCALE;
+    }
+    // 終局的棋子差 (P 的角度), 空格算給贏的一方
+    int final_score(uint64_t P, uint64_t O){
+        int p = popcount(P), o = popcount(O);
+        int empties = SIZE * SIZE - p - o;
+        if(p > o) return p - o + empties;
+        if(p < o) return p - o - empties;
+        return 0;
+    }
+    // minimax recursion ()
+    // this round(已經下了第 depth 手), depth, opponenet or me, alpha, beta
+    // 分數都是站在自己 (根節點玩家) 的角度, 所以直接存進置換表
+    int minimax(OthelloBoard & round, int depth, bool player_type, int alpha, int beta){
+        if(time_up()) return 0;
+        if(depth == limit_depth){
+            // evaluation 是剛下完的玩家的角度, 輪到自己下表示剛下的是對手
+            return player_type ? -evaluation(round) : evaluation(round);
+        }
+        int remaining = limit_depth - depth;
+        int hash_move = TT_NO_MOVE;
+        TTEntry entry;
+        if(tt.probe(round.get_key(), entry)){
+            hash_move = entry.move;
+            if(entry.depth >= remaining){
+                if(entry.bound == TT_EXACT) return entry.score;
+                if(entry.bound == TT_LOWER && entry.score >= beta) return entry.score;
+                if(entry.bound == TT_UPPER && entry.score <= alpha) return entry.score;
+            }
+        }
+        int alpha_orig = alpha, beta_orig = beta;
+        int best_move = TT_NO_MOVE;
+        MoveUndo & undo = undo_stack[depth];
+        MoveList moves(round.get_valid_mask());
+        // 置換表記的最佳步先下
+        for(int i = 1; i < moves.size; i++){
+            if(moves[i].sq == hash_move){
+                swap(moves[0], moves[i]);
+                break;
+            }
+        }
+        if(moves.size == 0){
+            // 雙方都不能下: 終局
+            if(!round.opponent_can_move()){
+                return player_type ? end_game_value(round) : -end_game_value(round);
+            }
+            round.make_pass(undo);
+            int value = minimax(round, depth + 1, !player_type, alpha, beta);
+            round.undo_pass(undo);
+            return value;
+        }
+        int best_value;
+        if(player_type){
+            best_value = -INF_VALUE;
+            for(Move & m: moves){
+                round.make_move(m.sq, undo);
+                int value = minimax(round, depth + 1, false, alpha, beta);
+                round.undo_move(undo);
+                if(stop) return 0;
+                if(value > best_value){
+                    best_value = value;
+                    best_move = m.sq;
+                }
+                alpha = max(alpha, best_value);
+                if(alpha >= beta) break;
+            }
+        } else {
+            best_value = INF_VALUE;
+            for(Move & m: moves){
+                round.make_move(m.sq, undo);
+                int value = minimax(round, depth + 1, true, alpha, beta);
+                round.undo_move(undo);
+                if(stop) return 0;
+                if(value < best_value){
+                    best_value = value;
+                    best_move = m.sq;
+                }
+                beta = min(beta, best_value);
+                if(beta <= alpha) break;
+            }
+        }
+        int bound = TT_EXACT;
+        if(best_value <= alpha_orig) bound = TT_UPPER;
+        else if(best_value >= beta_orig) bound = TT_LOWER;
+        tt.store(round.get_key(), remaining, bound, best_value, best_move);
+        return best_value;
+    }
+    // 排序: 置換表的步 > 這層的 killer > history + state_value
+    void order_moves(OthelloBoard & round, MoveList & moves, int depth, int hash_move){
+        const array<int, SIZE * SIZE> & hist = history[round.get_cur_player()];
+        for(Move & m: moves){
+            if(m.sq == hash_move) m.score = 1 << 30;
+            else if(m.sq == killers[depth][0]) m.score = 1 << 29;
+            else if(m.sq == killers[depth][1]) m.score = 1 << 28;
+            else m.score = hist[m.sq] + state_value[m.sq >> 3][m.sq & 7] * PRIOR_WEIGHT;
+        }
+        // 步數很少, 插入排序就夠了
+        for(int i = 1; i < moves.size; i++){
+            Move m = moves[i];
+            int j = i;
+            for(; j > 0 && moves[j - 1].score < m.score; j--)
+                moves[j] = moves[j - 1];
+            moves[j] = m;
+        }
+    }
+    // beta cutoff: 記 killer, 加 history, 統計第一步就 cutoff 的比例
+    void update_cutoff(OthelloBoard & round, int sq, int depth, int move_idx){
+        cutoffs++;
+        if(move_idx == 0) first_move_cutoffs++;
+        if(killers[depth][0] != sq){
+            killers[depth][1] = killers[depth][0];
+            killers[depth][0] = sq;
+        }
+        int remaining = limit_depth - depth;
+        history[round.get_cur_player()][sq] += remaining * remaining;
+    }
+    // 新的一次搜尋: history 減半, killer 清掉
+    void age_history(){
+        for(array<int, SIZE * SIZE> & hist: history)
+            for(int & h: hist)
+                h >>= 1;
+        for(array<int, 2> & k: killers)
+            k = {TT_NO_MOVE, TT_NO_MOVE};
+        cutoffs = first_move_cutoffs = 0;
+    }
+    // 以 round (已經下了 depth 手) 為根往下搜 d 層
+    int search_subtree(OthelloBoard & round, int depth, int d, int alpha, int beta){
+        int saved_limit = limit_depth;
+        limit_depth = depth + d;
+        int value = pvs(round, depth, alpha, beta);
+        limit_depth = saved_limit;
+        return value;
+    }
+    // 淺層搜尋預測深層的結果有 t 個 sigma 的把握在窗口外就直接回傳 beta 或 alpha, 沒剪回傳 INF_VALUE
+    int multi_probcut(OthelloBoard & round, int depth, int remaining, int alpha, int beta){
+        const ProbCutParam & param = PROBCUT_PARAMS[get_probcut_phase(round.get_dics_num())][remaining];
+        if(param.a <= 0 || alpha <= -INF_VALUE / 2 || beta >= INF_VALUE / 2) return INF_VALUE;
+        int shallow = PROBCUT_SHALLOW[remaining];
+        double margin = probcut_t * param.sigma;
+        int bound = (int)ceil((beta + margin - param.b) / param.a);
+        if(search_subtree(round, depth, shallow, bound - 1, bound) >= bound && !stop){
+            probcut_cuts++;
+            return beta;
+        }
+        bound = (int)floor((alpha - margin - param.b) / param.a);
+        if(search_subtree(round, depth, shallow, bound, bound + 1) <= bound && !stop){
+            probcut_cuts++;
+            return alpha;
+        }
+        return INF_VALUE;
+    }
+    // 同一個局面完整窗口各搜淺層和深層, 記一筆: 棋子數 深度 淺層分數 深層分數
+    void log_probcut_pair(OthelloBoard & round, int depth, int remaining){
+        logging = true;
+        int shallow = search_subtree(round, depth, PROBCUT_SHALLOW[remaining], -INF_VALUE, INF_VALUE);
+        int deep = search_subtree(round, depth, remaining, -INF_VALUE, INF_VALUE);
+        logging = false;
+        if(!stop){
+            probcut_log << round.get_dics_num() << " " << remaining << " " << shallow << " " << deep << "\n";
+        }
+    }
+    // negamax Principal Variation Search, 分數站在 round 輪到的玩家角度
+    // 第一步用完整窗口, 其他用 null window 證明不會更好, fail high 才重搜
+    int pvs(OthelloBoard & round, int depth, int alpha, int beta){
+        if(time_up()) return 0;
+        if(depth == limit_depth){
+            return -evaluation(round);
+        }
+        int remaining = limit_depth - depth;
+        int hash_move = TT_NO_MOVE;
+        TTEntry entry;
+        if(tt.probe(round.get_key(), entry)){
+            hash_move = entry.move;
+            // 記錄 ProbCut 資料時只用同深度的結果, 不然淺層搜尋會拿到深層的分數
+            if(entry.depth >= remaining && (!logging || entry.depth == remaining)){
+                if(entry.bound == TT_EXACT) return entry.score;
+                if(entry.bound == TT_LOWER && entry.score >= beta) return entry.score;
+                if(entry.bound == TT_UPPER && entry.score <= alpha) return entry.score;
+            }
+        }
+        if(remaining >= PROBCUT_MIN_DEPTH && remaining <= PROBCUT_MAX_DEPTH && !logging){
+            // 抽約 1/64 的節點記錄淺層/深層分數
+            if(probcut_log.is_open() && (round.get_key() >> 58) == 0){
+                log_probcut_pair(round, depth, remaining);
+            }
+            // null window 節點才剪, PV 保持完整
+            if(probcut && depth > 0 && beta - alpha == 1){
+                int value = multi_probcut(round, depth, remaining, alpha, beta);
+                if(value != INF_VALUE) return value;
+                if(stop) return 0;
+            }
+        }
+        MoveUndo & undo = undo_stack[depth];
+        MoveList moves(round.get_valid_mask());
+        if(moves.size == 0){
+            if(!round.opponent_can_move()){
+                return end_game_value(round);
+            }
+            round.make_pass(undo);
+            int value = -pvs(round, depth + 1, -beta, -alpha);
+            round.undo_pass(undo);
+            return value;
+        }
+        order_moves(round, moves, depth, hash_move);
+        int alpha_orig = alpha;
+        int best_value = -INF_VALUE;
+        int best_move = TT_NO_MOVE;
+        // ABDADA: 第一步以外, 別的執行緒正在搜的子節點先跳過, 第二輪再回來搜
+        bool defer = abdada && remaining >= ABDADA_MIN_DEPTH;
+        array<int, MAX_MOVES> deferred;
+        int n_deferred = 0;
+        bool cut = false;
+        for(int pass = 0; pass < 2 && !cut; pass++){
+            int n = pass == 0 ? moves.size : n_deferred;
+            for(int k = 0; k < n; k++){
+                int i = pass == 0 ? k : deferred[k];
+                round.make_move(moves[i].sq, undo);
+                uint64_t child = round.get_key();
+                if(defer && pass == 0 && i > 0 && tt.is_busy(child)){
+                    round.undo_move(undo);
+                    deferred[n_deferred++] = i;
+                    continue;
+                }
+                if(defer) tt.enter(child);
+                int value;
+                if(i == 0){
+                    value = -pvs(round, depth + 1, -beta, -alpha);
+                } else {
+                    value = -pvs(round, depth + 1, -alpha - 1, -alpha);
+                    if(value > alpha && value < beta){
+                        value = -pvs(round, depth + 1, -beta, -alpha);
+                    }
+                }
+                if(defer) tt.leave(child);
+                round.undo_move(undo);
+                if(stop) return 0;
+                if(value > best_value){
+                    best_value = value;
+                    best_move = moves[i].sq;
+                }
+                alpha = max(alpha, value);
+                if(alpha >= beta){
+                    update_cutoff(round, moves[i].sq, depth, i);
+                    cut = true;
+                    break;
+                }
+            }
+        }
+        int bound = TT_EXACT;
+        if(best_value <= alpha_orig) bound = TT_UPPER;
+        else if(best_value >= beta) bound = TT_LOWER;
+        // fail low 時每一步都只是上界, 保留原本記的最佳步
+        if(bound == TT_UPPER) best_move = TT_NO_MOVE;
+        tt.store(round.get_key(), remaining, bound, best_value, best_move);
+        return best_value;
+    }
+    void set_report_move(function<void(Point)> callback){
+        report_move = callback;
+    }
+    void report(int sq){
+        if(report_move && sq != reported_sq){
+            reported_sq = sq;
+            report_move(to_point(sq));
+        }
+    }
+    long long elapsed_ms(){
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_time).count();
+    }
+    // 每 1024 個節點看一次時間, 超過就放棄這一輪
+    bool time_up(){
+        if((++nodes & 1023) == 0 && (out_of_time() || *abort_flag)) stop = true;
+        return stop;
+    }
+    // ponder 時不看時鐘, 只看有沒有被取消
+    bool out_of_time(){
+        return (!master->pondering && elapsed_ms() >= time_limit_ms) || master->cancelled;
+    }
+    // 根節點在 (alpha, beta) 窗口內搜到 limit_depth 層, 回傳最好的 index, 分數存到 best_score
+    // best_score <= alpha 或 >= beta 時只是上下界, 要放寬窗口重搜
+    // 時間到時只看已經搜完的 (第一步是上一輪最好的), 沒證明出比 alpha 好的就回傳 -1
+    int search_root(int alpha, int beta, int & best_score){
+        int max_value = -INF_VALUE;
+        int choice_idx = 0;
+        // ABDADA: 別的執行緒正在搜的步先跳過, 排到最後再搜
+        array<int, 2 * MAX_MOVES> order;
+        int n_order = next_valid_spots.size;
+        for(int k = 0; k < n_order; k++) order[k] = k;
+        for(int k = 0; k < n_order; k++){
+            int i = order[k];
+            int bound = max(alpha, max_value);
+            first_round.make_move(next_valid_spots[i].sq, undo_stack[0]);
+            uint64_t child = first_round.get_key();
+            if(abdada && k < next_valid_spots.size && i > 0 && tt.is_busy(child)){
+                first_round.undo_move(undo_stack[0]);
+                order[n_order++] = i;
+                continue;
+            }
+            if(abdada) tt.enter(child);
+            if(search_mode == SEARCH_MINIMAX){
+                next_valid_spots[i].score = minimax(first_round, 1, false, alpha, beta);
+            } else if(i == 0){
+                next_valid_spots[i].score = -pvs(first_round, 1, -beta, -alpha);
+            } else {
+                // 證明不比目前最好的好就不用算準確分數
+                next_valid_spots[i].score = -pvs(first_round, 1, -bound - 1, -bound);
+                if(next_valid_spots[i].score > bound && next_valid_spots[i].score < beta && !stop){
+                    next_valid_spots[i].score = -pvs(first_round, 1, -beta, -bound);
+                }
+            }
+            if(abdada) tt.leave(child);
+            first_round.undo_move(undo_stack[0]);
+            if(stop){
+                best_score = max_value;
+                return k > 0 && max_value > alpha ? choice_idx : -1;
+            }
+            if(max_value < next_valid_spots[i].score){
+                max_value = next_valid_spots[i].score;
+                choice_idx = i;
+                // 第一步是上一輪的最好的一步, 證明比它好的就是這一層更好的一步
+                if(i > 0 && max_value > bound) report(next_valid_spots[i].sq);
+            }
+            if(max_value >= beta) break;
+            // 第一步搜完拿到 alpha 之後, 其他步分給所有執行緒
+            if(i == 0 && !helpers.empty() && parallel_mode == PARALLEL_ROOT && search_mode != SEARCH_MINIMAX){
+                return search_root_parallel(alpha, beta, max_value, best_score);
+            }
+        }
+        best_score = max_value;
+        return choice_idx;
+    }
+    // 每個工作執行緒一個 helper (最多 n_threads - 1 個), 盤面從目前的 root 複製
+    void start_helpers(int n_threads){
+        helpers.clear();
+        helper_rounds.clear();
+        for(int id = 1; id < min(n_threads, pool.size()); id++){
+            helper_rounds.push_back(make_unique<OthelloBoard>(first_round));
+            helpers.push_back(make_unique<AI>(*helper_rounds.back()));
+            AI & helper = *helpers.back();
+            helper.abort_flag = &abort_search;
+            helper.master = this;
+            helper.probcut_log.close();
+        }
+        workers.assign(1, this);
+        for(unique_ptr<AI> & helper: helpers){
+            workers.push_back(helper.get());
+            helper->workers = workers;
+        }
+        abdada = parallel_mode == PARALLEL_ABDADA && !helpers.empty();
+        for(unique_ptr<AI> & helper: helpers) helper->abdada = abdada;
+    }
+    // 第一步 (分數 first_value) 以外的步平行搜: 每個執行緒從共用的計數器拿下一步
+    // 共用目前最好的分數當窗口, 同分時選前面的, 所以結果和循序搜尋一樣
+    int search_root_parallel(int alpha, int beta, int first_value, int & best_score){
+        root_best_score = first_value;
+        root_best_idx = 0;
+        root_next = 1;
+        abort_search = false;
+        sync_helpers();
+        pool.run([&](int id){
+            if(id > (int)helpers.size()) return;
+            AI & worker = id == 0 ? *this : *helpers[id - 1];
+            worker.search_root_worker(*this, alpha, beta);
+        });
+        bool timed_out = stop;
+        for(unique_ptr<AI> & helper: helpers) timed_out |= helper->stop;
+        collect_helper_stats();
+        // fail high 叫停的不算時間到
+        bool aborted = abort_search;
+        abort_search = false;
+        stop = aborted ? out_of_time() : timed_out;
+        best_score = root_best_score;
+        if(stop && !aborted){
+            return root_best_score > alpha ? root_best_idx : -1;
+        }
+        if(root_best_idx > 0 && root_best_score > alpha) report(next_valid_spots[root_best_idx].sq);
+        return root_best_idx;
+    }
+    // helper 跟著主執行緒的搜尋設定
+    void sync_helpers(){
+        for(unique_ptr<AI> & helper: helpers){
+            helper->limit_depth = limit_depth;
+            helper->search_mode = search_mode;
+            helper->probcut = probcut;
+            helper->probcut_t = probcut_t;
+            helper->split_empties = split_empties;
+            helper->time_limit_ms = time_limit_ms;
+            helper->start_time = start_time;
+            helper->stop = false;
+        }
+    }
+    // helper 的節點數和統計加到主執行緒
+    void collect_helper_stats(){
+        for(unique_ptr<AI> & helper: helpers){
+            nodes += helper->nodes;
+            cutoffs += helper->cutoffs;
+            first_move_cutoffs += helper->first_move_cutoffs;
+            probcut_cuts += helper->probcut_cuts;
+            helper->nodes = helper->cutoffs = helper->first_move_cutoffs = helper->probcut_cuts = 0;
+        }
+    }
+    // Lazy SMP / ABDADA 的一輪: 所有執行緒同時搜同一個局面, 主執行緒搜完就叫 helper 停
+    // helper 的結果不直接用, 只是先把置換表填好讓主執行緒的搜尋變快
+    int search_iteration_lazy(int depth, int & score){
+        sync_helpers();
+        for(unique_ptr<AI> & helper: helpers){
+            helper->next_valid_spots = next_valid_spots;
+            helper->iteration_score = iteration_score;
+        }
+        int choice_idx = -1;
+        pool.run([&](int id){
+            if(id == 0){
+                choice_idx = search_iteration(depth, score);
+                abort_search = true;
+            } else if(id <= (int)helpers.size()){
+                helpers[id - 1]->lazy_helper_iteration(id, depth);
+            }
+        });
+        abort_search = false;
+        collect_helper_stats();
+        return choice_idx;
+    }
+    // 奇數編號的 helper 多搜一層, root 依編號換不同的步先搜, 讓各執行緒錯開
+    // ABDADA 的 helper 搜一樣的深度和順序, 靠跳過忙碌的子節點分工
+    void lazy_helper_iteration(int id, int depth){
+        if(abdada){
+            limit_depth = depth;
+            int score;
+            search_iteration(limit_depth, score);
+            return;
+        }
+        move_to_front(next_valid_spots[(id >> 1) % next_valid_spots.size].sq);
+        limit_depth = min(depth + (id & 1), SIZE * SIZE - first_round.get_dics_num());
+        int score;
+        search_iteration(limit_depth, score);
+    }
+    void search_root_worker(AI & master, int alpha, int beta){
+        while(true){
+            int i, bound;
+            {
+                lock_guard<mutex> lock(master.root_mutex);
+                i = master.root_next++;
+                if(i >= master.next_valid_spots.size) return;
+                // 排在目前最好的一步前面的, 同分也要算準 (循序搜尋同分時留前面的)
+                int best = master.root_best_score;
+                bound = max(alpha, master.root_best_idx < i ? best : best - 1);
+            }
+            first_round.make_move(master.next_valid_spots[i].sq, undo_stack[0]);
+            int value = -pvs(first_round, 1, -bound - 1, -bound);
+            if(value > bound && value < beta && !stop){
+                value = -pvs(first_round, 1, -beta, -bound);
+            }
+            first_round.undo_move(undo_stack[0]);
+            if(stop) return;
+            lock_guard<mutex> lock(master.root_mutex);
+            master.next_valid_spots[i].score = value;
+            if(value > master.root_best_score || (value == master.root_best_score && i < master.root_best_idx)){
+                master.root_best_score = value;
+                master.root_best_idx = i;
+            }
+            if(value >= beta) master.abort_search = true;
+        }
+    }
+    // 根節點的步移到最前面, 其他順序不變
+    void move_to_front(int sq){
+        for(int i = 0; i < next_valid_spots.size; i++){
+            if(next_valid_spots[i].sq == sq){
+                rotate(next_valid_spots.begin(), next_valid_spots.begin() + i, next_valid_spots.begin() + i + 1);
+                break;
+            }
+        }
+    }
+    // MTD(f): 從兩輪前 (同奇偶) 的分數開始, 反覆用 null window 搜根節點,
+    // fail high 提高下界, fail low 降低上界, 上下界相等就是答案; 重複的部分靠置換表省掉
+    // 回傳最後一次 fail high 的步 (移到最前面, index 0), 時間到還沒 fail high 過回傳 -1
+    int search_mtdf(int depth, int & score){
+        int g = depth > 2 ? iteration_score[depth - 2] : 0;
+        int lower = -INF_VALUE, upper = INF_VALUE;
+        int choice_idx = -1;
+        while(lower < upper){
+            int beta = g == lower ? g + 1 : g;
+            int idx = search_root(beta - 1, beta, g);
+            mtdf_passes++;
+            if(stop) break;
+            if(g >= beta){
+                lower = g;
+                move_to_front(next_valid_spots[idx].sq);
+                choice_idx = 0;
+            } else {
+                upper = g;
+            }
+        }
+        score = lower;
+        return choice_idx;
+    }
+    // 搜一輪: aspiration window 以兩輪前 (同奇偶層數, 評估函數的基準一致) 的分數為中心,
+    // fail low/high 就照 aspiration_widths 依序放寬, 用完就開全窗口
+    int search_iteration(int depth, int & score){
+        if(search_mode == SEARCH_MTDF){
+            return search_mtdf(depth, score);
+        }
+        int alpha = -INF_VALUE, beta = INF_VALUE;
+        int width_idx = 0;
+        bool aspiration = search_mode == SEARCH_PVS && depth > 2 && !aspiration_widths.empty();
+        if(aspiration){
+            int center = iteration_score[depth - 2];
+            alpha = center - aspiration_widths[0];
+            beta = center + aspiration_widths[0];
+            aspiration_searches++;
+        }
+        while(true){
+            int choice_idx = search_root(alpha, beta, score);
+            if(stop || (score > alpha && score < beta)){
+                return choice_idx;
+            }
+            int width = ++width_idx < (int)aspiration_widths.size() ? aspiration_widths[width_idx] : INF_VALUE;
+            if(score <= alpha){
+                fail_lows++;
+                alpha = width == INF_VALUE ? -INF_VALUE : max(score - width, -INF_VALUE);
+            } else {
+                fail_highs++;
+                beta = width == INF_VALUE ? INF_VALUE : min(score + width, INF_VALUE);
+                // fail high 的那一步已經證明比較好, 重搜時先搜它
+                move_to_front(next_valid_spots[choice_idx].sq);
+            }
+        }
+    }
+    // 固定深度搜一次 (不限時間, 清空置換表), 給對照用
+    int search_fixed_depth(int depth, int mode, int & score){
+        start_time = chrono::steady_clock::now();
+        time_limit_ms = INF_VALUE;
+        stop = false;
+        search_mode = mode;
+        probcut = false;
+        tt.clear();
+        start_helpers(pool.size());
+        limit_depth = depth;
+        int choice_idx;
+        if(mode == SEARCH_MTDF){
+            choice_idx = search_mtdf(depth, score);
+        } else {
+            choice_idx = search_root(-INF_VALUE, INF_VALUE, score);
+        }
+        return next_valid_spots[choice_idx].sq;
+    }
+    // 把空格照 state_value 由好到壞串起來
+    void init_empty_list(uint64_t empty){
+        array<int, SIZE * SIZE> squares;
+        int n = 0;
+        for(; empty; empty &= empty - 1)
+            squares[n++] = first_square(empty);
+        stable_sort(squares.begin(), squares.begin() + n, [this](int a, int b){
+            return state_value[a >> 3][a & 7] > state_value[b >> 3][b & 7];
+        });
+        int prev = EMPTY_HEAD;
+        for(int i = 0; i < n; i++){
+            empty_next[prev] = squares[i];
+            empty_prev[squares[i]] = prev;
+            prev = squares[i];
+        }
+        empty_next[prev] = EMPTY_HEAD;
+        empty_prev[EMPTY_HEAD] = prev;
+    }
+    void remove_empty(int sq){
+        empty_next[empty_prev[sq]] = empty_next[sq];
+        empty_prev[empty_next[sq]] = empty_prev[sq];
+    }
+    void restore_empty(int sq){
+        empty_next[empty_prev[sq]] = sq;
+        empty_prev[empty_next[sq]] = sq;
+    }
+    // 象限編號 (左上 0, 右上 1, 左下 2, 右下 3)
+    static int quadrant(int sq){
+        return (sq >> 5) << 1 | (sq >> 2 & 1);
+    }
+    // 最後 1~4 格的展開版終局搜尋, squares 是剩下的空格
+    // 最後一格不真的下, 直接用翻轉數算出棋子差; 3 格以上先下空格數是奇數的象限
+    template<int N>
+    int solve(uint64_t P, uint64_t O, int alpha, int beta, const int * squares, bool passed){
+        nodes++;
+        if constexpr (N == 1){
+            int sq = squares[0];
+            int discs = popcount(P);
+            int n_flips = popcount(flip(sq, P, O));
+            if(n_flips) return 2 * (discs + n_flips) - 62;
+            n_flips = popcount(flip(sq, O, P));
+            if(n_flips) return 2 * (discs - n_flips) - 64;
+            // 雙方都不能下, 最後一格給贏的一方
+            return discs * 2 > 63 ? 2 * discs - 62 : 2 * discs - 64;
+        } else {
+            array<int, N> order;
+            if constexpr (N >= 3){
+                int parity = 0;
+                for(int i = 0; i < N; i++) parity ^= 1 << quadrant(squares[i]);
+                int n = 0;
+                for(int i = 0; i < N; i++) if(parity >> quadrant(squares[i]) & 1) order[n++] = squares[i];
+                for(int i = 0; i < N; i++) if(!(parity >> quadrant(squares[i]) & 1)) order[n++] = squares[i];
+            } else {
+                for(int i = 0; i < N; i++) order[i] = squares[i];
+            }
+            int best_value = -INF_VALUE;
+            for(int i = 0; i < N; i++){
+                uint64_t f = flip(order[i], P, O);
+                if(!f) continue;
+                array<int, N - 1> rest;
+                for(int j = 0, k = 0; j < N; j++) if(j != i) rest[k++] = order[j];
+                int value = -solve<N - 1>(O & ~f, P | f | (1ULL << order[i]), -beta, -alpha, rest.data(), false);
+                if(value > best_value){
+                    best_value = value;
+                    if(value > alpha){
+                        alpha = value;
+                        if(alpha >= beta) break;
+                    }
+                }
+            }
+            if(best_value == -INF_VALUE){
+                if(passed) return final_score(P, O);
+                return -solve<N>(O, P, -beta, -alpha, squares, true);
+            }
+            return best_value;
+        }
+    }
+    // 精確終局搜尋 (PVS), 回傳 P 的角度的最後棋子差; passed 表示對手上一手 pass
+    int solve(uint64_t P, uint64_t O, int empties, int alpha, int beta, bool passed){
+        if(time_up() || split_cut()) return 0;
+        if(empties == 0) return final_score(P, O);
+        if(empties <= 4){
+            int squares[4];
+            int n = 0;
+            for(int sq = empty_next[EMPTY_HEAD]; sq != EMPTY_HEAD; sq = empty_next[sq])
+                squares[n++] = sq;
+            switch(empties){
+            case 1: return solve<1>(P, O, alpha, beta, squares, passed);
+            case 2: return solve<2>(P, O, alpha, beta, squares, passed);
+            case 3: return solve<3>(P, O, alpha, beta, squares, passed);
+            default: return solve<4>(P, O, alpha, beta, squares, passed);
+            }
+        }
+        // 穩定子剪枝: 對方的穩定子一定是對方的, 我最多拿到 64 - 對方穩定子
+        // 先用棋子數這個更鬆的界線過濾, 大部分節點不用真的算穩定子
+        if(empties >= STABILITY_EMPTIES){
+            if(alpha >= SIZE * SIZE - 2 * popcount(O)){
+                int upper = SIZE * SIZE - 2 * popcount(get_stable(O, P));
+                if(upper <= alpha) return upper;
+            }
+            if(beta <= 2 * popcount(P) - SIZE * SIZE){
+                int lower = 2 * popcount(get_stable(P, O)) - SIZE * SIZE;
+                if(lower >= beta) return lower;
+            }
+        }
+        uint64_t key = 0;
+        int hash_move = TT_NO_MOVE;
+        if(empties >= SOLVE_TT_EMPTIES){
+            key = hash_position(P, O);
+            TTEntry entry;
+            if(tt.probe(key, entry)){
+                hash_move = entry.move;
+                if(entry.bound == TT_EXACT) return entry.score;
+                if(entry.bound == TT_LOWER && entry.score >= beta) return entry.score;
+                if(entry.bound == TT_UPPER && entry.score <= alpha) return entry.score;
+            }
+        }
+        uint64_t valid = get_moves(P, O);
+        if(!valid){
+            if(passed) return final_score(P, O);
+            return -solve(O, P, empties, -beta, -alpha, true);
+        }
+        // 只走空格串列, 不掃 64 格
+        MoveList moves;
+        for(int sq = empty_next[EMPTY_HEAD]; sq != EMPTY_HEAD; sq = empty_next[sq]){
+            if(valid >> sq & 1) moves[moves.size++] = {sq, 0};
+        }
+        // fastest-first: 對手能下的步越少越先搜
+        if(empties >= FASTEST_FIRST_EMPTIES){
+            for(Move & m: moves){
+                uint64_t f = flip(m.sq, P, O);
+                m.score = m.sq == hash_move ? 1 << 30 : -popcount(get_moves(O & ~f, P | f | (1ULL << m.sq)));
+            }
+            for(int i = 1; i < moves.size; i++){
+                Move m = moves[i];
+                int j = i;
+                for(; j > 0 && moves[j - 1].score < m.score; j--)
+                    moves[j] = moves[j - 1];
+                moves[j] = m;
+            }
+        }
+        int alpha_orig = alpha;
+        int best_value = -INF_VALUE;
+        int best_move = TT_NO_MOVE;
+        for(int i = 0; i < moves.size; i++){
+            int sq = moves[i].sq;
+            uint64_t f = flip(sq, P, O);
+            uint64_t next_P = O & ~f, next_O = P | f | (1ULL << sq);
+            remove_empty(sq);
+            int value;
+            if(i == 0){
+                value = -solve(next_P, next_O, empties - 1, -beta, -alpha, false);
+            } else {
+                value = -solve(next_P, next_O, empties - 1, -alpha - 1, -alpha, false);
+                if(value > alpha && value < beta){
+                    value = -solve(next_P, next_O, empties - 1, -beta, -alpha, false);
+                }
+            }
+            restore_empty(sq);
+            if(stop || split_cut()) return 0;
+            if(value > best_value){
+                best_value = value;
+                best_move = sq;
+            }
+            alpha = max(alpha, value);
+            if(alpha >= beta) break;
+            // Young Brothers Wait: 第一步搜完沒被剪掉, 剩下的步開放給其他執行緒
+            if(i == 0 && ybwc && empties >= split_empties && moves.size > 2 && n_split_points < MAX_SPLITS){
+                split(P, O, empties, alpha, beta, moves, best_value, best_move);
+                if(stop || split_cut()) return 0;
+                break;
+            }
+        }
+        if(empties >= SOLVE_TT_EMPTIES){
+            int bound = TT_EXACT;
+            if(best_value <= alpha_orig) bound = TT_UPPER;
+            else if(best_value >= beta) bound = TT_LOWER;
+            if(bound == TT_UPPER) best_move = TT_NO_MOVE;
+            tt.store(key, empties, bound, best_value, best_move);
+        }
+        return best_value;
+    }
+    // 自己或外層的分割點已經被剪掉了
+    bool split_cut(){
+        for(SplitPoint * sp = active_split; sp; sp = sp->parent)
+            if(sp->cutoff) return true;
+        return false;
+    }
+    // 開一個分割點: moves[0] 已經搜完, 剩下的步自己和來幫忙的執行緒一起搜, 等大家都搜完才回傳
+    void split(uint64_t P, uint64_t O, int empties, int alpha, int beta, const MoveList & moves,
+               int & best_value, int & best_move){
+        SplitPoint & sp = split_points[n_split_points++];
+        sp.P = P;
+        sp.O = O;
+        sp.empties = empties;
+        sp.beta = beta;
+        sp.moves = moves;
+        sp.parent = active_split;
+        sp.next = 1;
+        sp.alpha = alpha;
+        sp.best_value = best_value;
+        sp.best_move = best_move;
+        sp.helpers = 0;
+        sp.cutoff = false;
+        sp.stopped = false;
+        active_split = &sp;
+        work.push(&sp, master->idle);
+        search_split(sp);
+        work.pop();
+        // helpful master: 等 helper 搜完的時候去幫他們在 sp 底下開的分割點, 沒有就睡
+        IdleSignal & idle = master->idle;
+        while(sp.helpers > 0){
+            int seen = idle.generation;
+            SplitPoint * child = stop ? NULL : steal_work(&sp);
+            if(child){
+                join_split(*child);
+                continue;
+            }
+            idle.wait(seen, [&]{ return sp.helpers == 0; });
+        }
+        active_split = sp.parent;
+        n_split_points--;
+        // 有步沒搜完就當作自己也時間到, 呼叫的 solve 不會存進置換表
+        if(sp.stopped) stop = true;
+        best_value = sp.best_value;
+        best_move = sp.best_move;
+    }
+    // 從分割點拿還沒搜的步來搜, 有人 beta cut 就通知所有在這裡和更深處搜的執行緒停
+    void search_split(SplitPoint & sp){
+        while(!sp.cutoff){
+            int i = sp.next++;
+            if(i >= sp.moves.size) return;
+            int sq = sp.moves[i].sq;
+            uint64_t f = flip(sq, sp.P, sp.O);
+            uint64_t next_P = sp.O & ~f, next_O = sp.P | f | (1ULL << sq);
+            int alpha = sp.alpha;
+            remove_empty(sq);
+            int value = -solve(next_P, next_O, sp.empties - 1, -alpha - 1, -alpha, false);
+            if(value > alpha && value < sp.beta && !stop && !split_cut()){
+                value = -solve(next_P, next_O, sp.empties - 1, -sp.beta, -alpha, false);
+            }
+            restore_empty(sq);
+            if(stop){
+                sp.stopped = true;
+                return;
+            }
+            if(split_cut()) return;
+            lock_guard<mutex> lock(sp.m);
+            if(value > sp.best_value){
+                sp.best_value = value;
+                sp.best_move = sq;
+            }
+            if(value > sp.alpha){
+                sp.alpha = value;
+                if(value >= sp.beta) sp.cutoff = true;
+            }
+        }
+    }
+    // 從別的執行緒的分割點找工作 (under 見 WorkDeque::steal)
+    SplitPoint * steal_work(const SplitPoint * under = NULL){
+        for(AI * worker: workers){
+            if(worker == this) continue;
+            if(SplitPoint * sp = worker->work.steal(under)) return sp;
+        }
+        return NULL;
+    }
+    // 加入 steal 到的分割點搜到沒有步; 自己原本的空格串列和所在的分割點搜完要還原
+    void join_split(SplitPoint & sp){
+        array<int, SIZE * SIZE + 1> saved_next = empty_next, saved_prev = empty_prev;
+        SplitPoint * saved_split = active_split;
+        init_empty_list(~(sp.P | sp.O));
+        active_split = &sp;
+        search_split(sp);
+        active_split = saved_split;
+        empty_next = saved_next;
+        empty_prev = saved_prev;
+        sp.helpers--;
+        master->idle.notify();
+    }
+    // helper 在終局搜尋時一直找別的執行緒的分割點幫忙, 沒有就睡, 直到主執行緒搜完, 被取消或自己時間到
+    void steal_loop(AI & master){
+        IdleSignal & idle = master.idle;
+        while(!master.ybwc_done && !master.cancelled && !stop){
+            int seen = idle.generation;
+            SplitPoint * sp = steal_work();
+            if(sp){
+                join_split(*sp);
+                continue;
+            }
+            idle.wait(seen, [&]{ return master.ybwc_done || master.cancelled; });
+        }
+    }
+    // 有 helper 時用 YBWC 平行搜, 根節點還是一步一步來, 所以結果和單執行緒一樣
+    int solve_endgame(int first_sq, bool wld, int & score){
+        if(helpers.empty()) return solve_root(first_sq, wld, score);
+        sync_helpers();
+        ybwc_done = false;
+        for(AI * worker: workers) worker->ybwc = true;
+        int best_sq = -1;
+        pool.run([&](int id){
+            if(id == 0){
+                best_sq = solve_root(first_sq, wld, score);
+                ybwc_done = true;
+                idle.notify();
+            } else if(id <= (int)helpers.size()){
+                helpers[id - 1]->steal_loop(*this);
+            }
+        });
+        for(AI * worker: workers) worker->ybwc = false;
+        bool timed_out = stop;
+        for(unique_ptr<AI> & helper: helpers) timed_out |= helper->stop;
+        stop = timed_out;
+        collect_helper_stats();
+        return best_sq;
+    }
+    // 根節點的終局搜尋, first_sq 先搜, 其他 fastest-first
+    // wld 只用 0 附近的窗口判斷勝/和/敗, 分數是 1/0/-1; 不然算精確的棋子差
+    // 回傳最好的一步, 時間到時只看已經證明的, 什麼都沒證明出來回傳 -1
+    int solve_root(int first_sq, bool wld, int & score){
+        init_empty_list(~(first_round.get_player_discs() | first_round.get_opponent_discs()));
+        uint64_t P = first_round.get_player_discs(), O = first_round.get_opponent_discs();
+        int empties = SIZE * SIZE - first_round.get_dics_num();
+        MoveList moves = next_valid_spots;
+        for(Move & m: moves){
+            uint64_t f = flip(m.sq, P, O);
+            m.score = m.sq == first_sq ? 1 << 30 : -popcount(get_moves(O & ~f, P | f | (1ULL << m.sq)));
+        }
+        stable_sort(moves.begin(), moves.end(), [](const Move & a, const Move & b){
+            return a.score > b.score;
+        });
+        int alpha = wld ? -1 : -INF_VALUE;
+        int beta = wld ? 1 : INF_VALUE;
+        int best_sq = -1;
+        int best_value = -INF_VALUE;
+        for(int i = 0; i < moves.size; i++){
+            int sq = moves[i].sq;
+            uint64_t f = flip(sq, P, O);
+            uint64_t next_P = O & ~f, next_O = P | f | (1ULL << sq);
+            remove_empty(sq);
+            int value;
+            if(i == 0){
+                value = -solve(next_P, next_O, empties - 1, -beta, -alpha, false);
+            } else {
+                value = -solve(next_P, next_O, empties - 1, -alpha - 1, -alpha, false);
+                if(value > alpha && value < beta && !stop){
+                    value = -solve(next_P, next_O, empties - 1, -beta, -alpha, false);
+                }
+            }
+            restore_empty(sq);
+            if(stop) break;
+            if(wld) value = (value > 0) - (value < 0);
+            if(value > best_value){
+                best_value = value;
+                best_sq = sq;
+                report(sq);
+            }
+            alpha = max(alpha, value);
+            if(alpha >= beta) break;
+        }
+        score = best_value;
+        return best_sq;
+    }
+    // 測試用: 不限時間用 n_threads 個執行緒 iterative deepening 到 depth 層
+    int search_to_depth(int depth, int n_threads, int & score){
+        start_time = chrono::steady_clock::now();
+        time_limit_ms = INF_VALUE;
+        stop = false;
+        tt.clear();
+        start_helpers(n_threads);
+        int best_sq = iterative_deepening(next_valid_spots[0].sq, depth);
+        score = iteration_score[depth];
+        return best_sq;
+    }
+    // 測試用: 讓空格少的局面也會分割, 才能和暴力搜尋對照
+    void set_split_empties(int empties){
+        split_empties = empties;
+    }
+    // 測試用: 不看環境變數, 直接指定平行模式和每步的時間
+    void set_parallel_mode(int mode){
+        parallel_mode = mode;
+    }
+    void set_time_limit(int ms){
+        time_limit_ms = ms;
+    }
+    void set_probcut(bool on){
+        probcut = on;
+    }
+    // 測試用: 不限時間用 n_threads 個執行緒直接算終局
+    int solve_exact(bool wld, int n_threads, int & score){
+        start_time = chrono::steady_clock::now();
+        time_limit_ms = INF_VALUE;
+        stop = false;
+        tt.clear();
+        start_helpers(n_threads);
+        return solve_endgame(-1, wld, score);
+    }
+    // 測試用: 最多算 time_ms, 置換表不清掉; 回傳是否在時間內算完
+    bool solve_limited(bool wld, int n_threads, int time_ms, int & score){
+        start_time = chrono::steady_clock::now();
+        time_limit_ms = time_ms;
+        stop = false;
+        start_helpers(n_threads);
+        solve_endgame(-1, wld, score);
+        return !stop;
+    }
+    // return the best choice this round
+    // iterative deepening: 1, 2, 3... 層直到時間用完, 用最後一輪搜完的結果
+    // start 是這一步開始計時的時間 (預設是現在)
+    Point best_choice(chrono::steady_clock::time_point start = chrono::steady_clock::now()){
+        start_time = start;
+        stop = false;
+        nodes = 0;
+        aspiration_searches = fail_lows = fail_highs = 0;
+        mtdf_passes = 0;
+        probcut_cuts = 0;
+        tt.new_search();
+        age_history();
+        start_helpers(pool.size());
+        int best_sq = next_valid_spots[0].sq;
+        reported_sq = -1;
+        report(best_sq);
+        if(next_valid_spots.size == 1){
+            return to_point(best_sq);
+        }
+        int empties = SIZE * SIZE - first_round.get_dics_num();
+        // 門檻是 1 秒的設定, 每多 3 倍時間大約能多算一格
+        int extra = (int)floor(log(max(time_limit_ms, 1) / 1000.0) / log(3.0));
+        if(empties <= wld_empties + extra){
+            // 先用 1/8 的時間跑中盤搜尋, 拿到保底的一步和根節點的排序, 剩下的時間算終局
+            int budget = time_limit_ms;
+            time_limit_ms = budget / 8;
+            // ponder 時不看時間, 中盤搜尋改成限制深度, 時間都留給終局
+            best_sq = iterative_deepening(best_sq, pondering ? PONDER_MIDGAME_DEPTH : SIZE * SIZE);
+            time_limit_ms = budget;
+            stop = false;
+            bool wld = empties > exact_empties + extra;
+            int score;
+            int solved_sq = solve_endgame(best_sq, wld, score);
+            if(solved_sq >= 0 && (!stop || solved_sq != best_sq)){
+                best_sq = solved_sq;
+            }
+            if(verbose){
+                cerr << (wld ? "wld " : "exact ") << (stop ? "timeout" : "solved") << " empties " << empties
+                     << " best " << to_point(best_sq).x << " " << to_point(best_sq).y
+                     << " score " << score << " nodes " << nodes << " time " << elapsed_ms() << "ms" << endl;
+            }
+            report(best_sq);
+            return to_point(best_sq);
+        }
+        return to_point(iterative_deepening(best_sq));
+    }
+    // iterative deepening 直到 time_limit_ms 用完或搜完 max_depth 層, 回傳最後一輪搜完的最好的一步
+    int iterative_deepening(int best_sq, int max_depth = SIZE * SIZE){
+        int empties = SIZE * SIZE - first_round.get_dics_num();
+        for(int depth = 1; depth <= min(empties, max_depth); depth++){
+            // 上一輪最好的先搜
+            move_to_front(best_sq);
+            limit_depth = depth;
+            int score;
+            bool lazy = !helpers.empty() && parallel_mode != PARALLEL_ROOT;
+            int choice_idx = lazy ? search_iteration_lazy(depth, score) : search_iteration(depth, score);
+            if(choice_idx < 0) break;
+            best_sq = next_valid_spots[choice_idx].sq;
+            iteration_score[depth] = score;
+            report(best_sq);
+            if(stop) break;
+            if(verbose){
+                cerr << "depth " << depth << " best " << to_point(best_sq).x << " " << to_point(best_sq).y
+                     << " score " << score << " nodes " << nodes
+                     << " time " << elapsed_ms() << "ms"
+                     << " first-move cutoffs " << first_move_cutoffs << "/" << cutoffs
+                     << " aspiration fail low/high " << fail_lows << "/" << fail_highs
+                     << " of " << aspiration_searches << " mtdf passes " << mtdf_passes
+                     << " probcut cuts " << probcut_cuts << endl;
+            }
+            // 下一輪通常要花好幾倍時間, 剩不到一半就不開始
+            if(!pondering && elapsed_ms() * 2 >= time_limit_ms) break;
+        }
+        return best_sq;
+    }
+};
+
+class Engine {
+private:
+    int player;
+    array<array<int, SIZE>, SIZE> board;
+    vector<Point> next_valid_spots;
+    // daemon 模式下同一個 Engine 回答每一步, 盤面和 AI (history, 設定) 留著給下一步用
+    unique_ptr<OthelloBoard> first_round;
+    unique_ptr<AI> ai;
+    // ponder: 回答之後在背景搜「我們這一步 + 預測的對手回應」的局面, first_round 就是那個局面
+    bool ponder_enabled;
+    thread ponder_thread;
+    Point ponder_move;
+    // 預測的局面; 搜尋時 first_round 會被 make/undo, 所以另外存一份來比對
+    unique_ptr<OthelloBoard> ponder_round;
+    // 搜尋回報的最好一步; out 是目前要寫的輸出檔, ponder 時是 NULL
+    mutex report_mutex;
+    std::ofstream * out;
+    Point reported, written;
+    // 這一步開始計時的時間, 時間限制從這裡算
+    chrono::steady_clock::time_point move_start;
+    void write_move(Point p) {
+        *out << p.x << " " << p.y << std::endl;
+        // Remember to flush the output to ensure the last action is written to file.
+        out->flush();
+        written = p;
+    }
+    bool same_position(OthelloBoard & a, OthelloBoard & b) {
+        return a.get_cur_player() == b.get_cur_player() && a.get_player_discs() == b.get_player_discs()
+            && a.get_opponent_discs() == b.get_opponent_discs();
+    }
+    // 猜錯或結束時叫停背景的搜尋並等它結束
+    void cancel_ponder() {
+        if (!ponder_thread.joinable())
+            return;
+        ai->cancel();
+        ponder_thread.join();
+        ai->reset_cancel();
+    }
+    // 我們下 p 之後, 對手下預測的那一步 (或 pass), 輪到我們時在背景先搜
+    void start_ponder(Point p) {
+        OthelloBoard next = *first_round;
+        MoveUndo undo;
+        next.make_move(to_square(p), undo);
+        if (next.get_valid_mask()) {
+            next.make_move(ai->predict_reply(next), undo);
+        } else if (next.opponent_can_move()) {
+            next.make_pass(undo);
+        } else {
+            return;
+        }
+        // 輪到我們卻不能下 (要 pass 或結束) 就沒什麼好想的
+        if (!next.get_valid_mask())
+            return;
+        *first_round = next;
+        ponder_round = make_unique<OthelloBoard>(next);
+        ai->load_position();
+        ai->set_pondering(true);
+        ponder_thread = thread([this] { ponder_move = ai->best_choice(); });
+    }
+public:
+    Engine() : ponder_enabled(false), out(NULL), move_start(PROCESS_START) {}
+    ~Engine() {
+        cancel_ponder();
+    }
+    void set_ponder(bool on) {
+        ponder_enabled = on;
+    }
+    void set_move_start(chrono::steady_clock::time_point start) {
+        move_start = start;
+    }
+    void read_board(std::ifstream& fin) {
+        fin >> player;
+        for (int i = 0; i < SIZE; i++) {
+            for (int j = 0; j < SIZE; j++) {
+                fin >> board[i][j];
+            }
+        }
+    }
+    void read_valid_spots(std::ifstream& fin) {
+        int n_valid_spots;
+        fin >> n_valid_spots;
+        next_valid_spots.clear();
+        int x, y;
+        for (int i = 0; i < n_valid_spots; i++) {
+            fin >> x >> y;
+            next_valid_spots.push_back({x, y});
+        }
+    }
+
+    void write_valid_spot(std::ofstream& fout) {
+        OthelloBoard round(board, next_valid_spots, player);
+        Point p;
+        if (ponder_thread.joinable() && same_position(round, *ponder_round)) {
+            // ponder 猜中: 先寫目前最好的一步, 再照一般的時間限制搜完, ponder 夠久的話馬上就結束
+            {
+                lock_guard<mutex> lock(report_mutex);
+                out = &fout;
+                written = Point(-1, -1);
+                if (reported != Point(-1, -1))
+                    write_move(reported);
+            }
+            ai->set_pondering(false);
+            ponder_thread.join();
+            p = ponder_move;
+        } else {
+            cancel_ponder();
+            if (!ai) {
+                first_round = make_unique<OthelloBoard>(round);
+                ai = make_unique<AI>(*first_round);
+                // 搜尋中每次最好的一步改變就再寫一行, 被中途終止時最後一行仍是合法的一步
+                ai->set_report_move([this](Point p) {
+                    lock_guard<mutex> lock(report_mutex);
+                    reported = p;
+                    if (out && p != written)
+                        write_move(p);
+                });
+            } else {
+                *first_round = round;
+                ai->load_position();
+            }
+            {
+                lock_guard<mutex> lock(report_mutex);
+                out = &fout;
+                written = Point(-1, -1);
+            }
+            p = ai->best_choice(move_start);
+        }
+        {
+            lock_guard<mutex> lock(report_mutex);
+            if (p != written)
+                write_move(p);
+            out = NULL;
+            reported = Point(-1, -1);
+        }
+        if (ponder_enabled)
+            start_ponder(p);
+    }
+};
+
+#ifdef DEBUG_CHECK
+// 開局盤面, 黑棋先下
+OthelloBoard initial_board() {
+    array<array<int, SIZE>, SIZE> board{};
+    board[3][3] = board[4][4] = 2;
+    board[3][4] = board[4][3] = 1;
+    vector<Point> spots = {Point(2, 3), Point(3, 2), Point(4, 5), Point(5, 4)};
+    return OthelloBoard(board, spots, 1);
+}
+// 從開局隨機下到剩 empties 個空格, 中途輪到的人不能下就停在那裡
+OthelloBoard random_position(int empties) {
+    OthelloBoard game = initial_board();
+    while (SIZE * SIZE - game.get_dics_num() > empties && game.get_valid_mask()) {
+        vector<Point> valid = game.get_cur_next_valid_spots();
+        game.put_disc(valid[rand() % valid.size()]);
+    }
+    return game;
+}
+// 用舊版陣列棋盤對照位元棋盤: 隨機下完整盤棋, 每步比對盤面與合法位置
+int check_boards(int n_games) {
+    srand(time(NULL));
+    int errors = 0;
+    for (int g = 0; g < n_games; g++) {
+        OthelloBoard game = initial_board();
+        ArrayOthelloBoard ref(game.get_cur_board(), game.get_cur_next_valid_spots(), 1);
+        while (true) {
+            vector<Point> ref_spots = ref.get_valid_spots();
+            if (ref.get_cur_board() != game.get_cur_board() || ref_spots != game.get_valid_spots()) {
+                errors++;
+                break;
+            }
+            if (ref_spots.empty())
+                break;
+            Point p = ref_spots[rand() % ref_spots.size()];
+            ref.put_disc(p);
+            game.put_disc(p);
+        }
+    }
+    cout << "check_boards: " << n_games << " games, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// 隨機下完整盤棋: 算出來的穩定子之後都不能被翻, 下滿時全部都是穩定子
+int check_stability(int n_games) {
+    int errors = 0;
+    for (int g = 0; g < n_games; g++) {
+        OthelloBoard game = initial_board();
+        uint64_t stable[3] = {0, 0, 0};
+        while (true) {
+            int player = game.get_cur_player();
+            uint64_t discs[3];
+            discs[player] = game.get_player_discs();
+            discs[3 - player] = game.get_opponent_discs();
+            for (int c = 1; c <= 2; c++) {
+                if ((stable[c] & discs[c]) != stable[c])
+                    errors++;
+                stable[c] = get_stable(discs[c], discs[3 - c]);
+                if ((stable[c] & discs[c]) != stable[c])
+                    errors++;
+            }
+            if (game.get_dics_num() == SIZE * SIZE && (stable[1] | stable[2]) != ~0ULL)
+                errors++;
+            vector<Point> valid = game.get_cur_next_valid_spots();
+            if (valid.empty())
+                break;
+            game.put_disc(valid[rand() % valid.size()]);
+        }
+    }
+    cout << "check_stability: " << n_games << " games, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// PVS 和舊的 minimax 在隨機局面上要選一樣的步, 分數也要一樣 (MTD(f) 只比分數)
+int check_search(int n_positions) {
+    int errors = 0;
+    for (int n = 0; n < n_positions; n++) {
+        int plies = rand() % 56;
+        OthelloBoard game = random_position(SIZE * SIZE - 4 - plies);
+        if (!game.get_valid_mask())
+            continue;
+        AI ai(game);
+        for (int depth = 1; depth <= 6; depth++) {
+            int minimax_score, pvs_score, mtdf_score;
+            int minimax_sq = ai.search_fixed_depth(depth, SEARCH_MINIMAX, minimax_score);
+            int pvs_sq = ai.search_fixed_depth(depth, SEARCH_PVS, pvs_score);
+            if (minimax_sq != pvs_sq || minimax_score != pvs_score)
+                errors++;
+            // MTD(f) 分數要一樣, 同分時選的步可以不同
+            ai.search_fixed_depth(depth, SEARCH_MTDF, mtdf_score);
+            if (mtdf_score != pvs_score)
+                errors++;
+        }
+    }
+    cout << "check_search: " << n_positions << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// 不剪枝的終局搜尋, 給 check_endgame 對照用
+int brute_force_value(OthelloBoard & game, bool passed) {
+    uint64_t valid = game.get_valid_mask();
+    MoveUndo undo;
+    if (!valid) {
+        uint64_t P = game.get_player_discs(), O = game.get_opponent_discs();
+        if (passed) {
+            int p = popcount(P), o = popcount(O), e = SIZE * SIZE - p - o;
+            return p > o ? p - o + e : p < o ? p - o - e : 0;
+        }
+        game.make_pass(undo);
+        int value = -brute_force_value(game, true);
+        game.undo_pass(undo);
+        return value;
+    }
+    int best = -INF_VALUE;
+    for (; valid; valid &= valid - 1) {
+        game.make_move(first_square(valid), undo);
+        best = max(best, -brute_force_value(game, false));
+        game.undo_move(undo);
+    }
+    return best;
+}
+// 終局精確解要和暴力搜尋的分數一樣, WLD 要和它的正負號一樣
+int check_endgame(int n_positions) {
+    int errors = 0, tested = 0;
+    for (int n = 0; n < n_positions; n++) {
+        OthelloBoard game = random_position(6 + rand() % 5);
+        if (!game.get_valid_mask())
+            continue;
+        AI ai(game);
+        int score, wld_score;
+        ai.solve_exact(false, thread_pool().size(), score);
+        if (score != brute_force_value(game, false))
+            errors++;
+        // 勝/和/敗要和精確分數的正負號一樣
+        ai.solve_exact(true, thread_pool().size(), wld_score);
+        if (wld_score != (score > 0) - (score < 0))
+            errors++;
+        tested++;
+    }
+    cout << "check_endgame: " << tested << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// 多執行緒的終局搜尋被時間中斷幾次之後, 沿用同一個置換表再算完, 分數要和乾淨的置換表一樣
+// (被中斷的搜尋不能存不完整的結果); 要用 OTHELLO_THREADS > 1 跑才有 helper
+int check_interrupted_solve(int n_positions, int empties) {
+    int errors = 0, tested = 0;
+    for (int n = 0; n < n_positions; n++) {
+        OthelloBoard game = random_position(empties);
+        if (!game.get_valid_mask())
+            continue;
+        AI ai(game);
+        int ref_score, score;
+        ai.solve_exact(false, thread_pool().size(), ref_score);
+        shared_tt().clear();
+        for (int i = 0; i < 5; i++)
+            ai.solve_limited(false, thread_pool().size(), 1 + rand() % 8, score);
+        ai.solve_limited(false, thread_pool().size(), INF_VALUE, score);
+        if (score != ref_score)
+            errors++;
+        tested++;
+    }
+    cout << "check_interrupted_solve: " << tested << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// ponder 猜錯時在終局搜尋中途取消, 之後沿用同一個置換表再算一次, 分數要和暴力搜尋一樣
+// 空格少一點暴力搜尋才算得完, 所以分割的門檻也調低; 一局 ponder 只要幾 ms, 在 5ms 內隨機取消
+// 要用 OTHELLO_THREADS > 1 跑才有 helper, 執行緒越多越容易遇到 helper 先停下來的情況
+int check_cancelled_ponder(int n_positions, int empties) {
+    int errors = 0, tested = 0;
+    for (int n = 0; n < n_positions; n++) {
+        OthelloBoard game = random_position(empties);
+        if (!game.get_valid_mask())
+            continue;
+        shared_tt().clear();
+        AI ai(game);
+        ai.set_split_empties(empties - 4);
+        ai.set_pondering(true);
+        thread ponder([&ai] { ai.best_choice(); });
+        this_thread::sleep_for(chrono::microseconds(rand() % 5000));
+        ai.cancel();
+        ponder.join();
+        ai.reset_cancel();
+        int score;
+        ai.solve_limited(false, thread_pool().size(), INF_VALUE, score);
+        if (score != brute_force_value(game, false))
+            errors++;
+        tested++;
+    }
+    cout << "check_cancelled_ponder: " << tested << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// root 平行模式下 ponder 超過時間限制還要繼續搜 (root fail high 叫停 helper 時不能順便看時鐘), 直到被取消
+// 要用 OTHELLO_THREADS > 1 跑才有 helper
+int check_ponder_root(int n_positions) {
+    int errors = 0, tested = 0;
+    for (int n = 0; n < n_positions; n++) {
+        OthelloBoard game = random_position(30 + rand() % 10);
+        if (game.get_cur_next_valid_spots().size() < 2)
+            continue;
+        AI ai(game);
+        ai.set_parallel_mode(PARALLEL_ROOT);
+        ai.set_time_limit(10);
+        ai.set_pondering(true);
+        atomic<bool> done(false);
+        thread ponder([&] { ai.best_choice(); done = true; });
+        this_thread::sleep_for(chrono::milliseconds(200));
+        if (done)
+            errors++;
+        ai.cancel();
+        ponder.join();
+        ai.reset_cancel();
+        tested++;
+    }
+    cout << "check_ponder_root: " << tested << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// ABDADA 的 helper 一起搜 (search_iteration_lazy) 時, 分數要和單執行緒固定深度的搜尋一樣
+// Lazy SMP 的 helper 會多搜一層, 置換表裡較深的結果本來就會讓分數不同, 所以只對照 ABDADA
+// 要用 OTHELLO_THREADS > 1 跑才有 helper
+int check_parallel_search(int n_positions, int max_depth) {
+    int errors = 0, tested = 0;
+    for (int n = 0; n < n_positions; n++) {
+        int plies = 10 + rand() % 30;
+        OthelloBoard game = random_position(SIZE * SIZE - 4 - plies);
+        if (!game.get_valid_mask())
+            continue;
+        int depth = 1 + rand() % max_depth;
+        AI ai(game);
+        int ref_score, score;
+        ai.search_fixed_depth(depth, SEARCH_PVS, ref_score);
+        ai.set_parallel_mode(PARALLEL_ABDADA);
+        ai.set_probcut(false);
+        ai.search_to_depth(depth, thread_pool().size(), score);
+        if (score != ref_score)
+            errors++;
+        tested++;
+    }
+    cout << "check_parallel_search: " << tested << " positions, " << errors << " errors" << endl;
+    return errors != 0;
+}
+// 固定的一組中盤局面各搜到 depth 層, 比較不同執行緒數 (最多 OTHELLO_THREADS) 花的時間
+int bench_threads(int n_positions, int depth) {
+    srand(1);
+    vector<OthelloBoard> positions;
+    while ((int)positions.size() < n_positions) {
+        int plies = 16 + rand() % 16;
+        OthelloBoard game = random_position(SIZE * SIZE - 4 - plies);
+        if (game.get_valid_mask())
+            positions.push_back(game);
+    }
+    int max_threads = thread_pool().size();
+    double base_ms = 0;
+    for (int n_threads = 1; ; n_threads = min(n_threads * 2, max_threads)) {
+        double total_ms = 0;
+        for (OthelloBoard & position: positions) {
+            AI ai(position);
+            int score;
+            chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+            ai.search_to_depth(depth, n_threads, score);
+            total_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        }
+        if (n_threads == 1)
+            base_ms = total_ms;
+        cout << "bench_threads: " << n_threads << " threads, depth " << depth << ", " << total_ms << "ms, speedup "
+             << base_ms / total_ms << endl;
+        if (n_threads == max_threads)
+            break;
+    }
+    return 0;
+}
+// 固定的一組終局局面 (empties 個空格) 算精確解, 比較不同執行緒數花的時間, 分數要和單執行緒一樣
+int bench_endgame(int n_positions, int empties) {
+    srand(2);
+    vector<OthelloBoard> positions;
+    while ((int)positions.size() < n_positions) {
+        OthelloBoard game = random_position(empties);
+        if (game.get_valid_mask())
+            positions.push_back(game);
+    }
+    int max_threads = thread_pool().size();
+    int errors = 0;
+    double base_ms = 0;
+    vector<int> base_scores;
+    for (int n_threads = 1; ; n_threads = min(n_threads * 2, max_threads)) {
+        double total_ms = 0;
+        for (int i = 0; i < n_positions; i++) {
+            AI ai(positions[i]);
+            int score;
+            chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+            ai.solve_exact(false, n_threads, score);
+            total_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            if (n_threads == 1)
+                base_scores.push_back(score);
+            else if (score != base_scores[i])
+                errors++;
+        }
+        if (n_threads == 1)
+            base_ms = total_ms;
+        cout << "bench_endgame: " << n_threads << " threads, " << empties << " empties, " << total_ms << "ms, speedup "
+             << base_ms / total_ms << ", " << errors << " errors" << endl;
+        if (n_threads == max_threads)
+            break;
+    }
+    return errors != 0;
+}
+// 每組 CPU 支援的實作都要和純量版結果一樣
+int check_backends(int n_positions) {
+    int errors = 0;
+    for (const Backend & b: BACKENDS) {
+        if (!b.supported())
+            continue;
+        for (int i = 0; i < n_positions; i++) {
+            uint64_t r1 = (uint64_t)rand() << 33 ^ (uint64_t)rand() << 11 ^ rand();
+            uint64_t r2 = (uint64_t)rand() << 33 ^ (uint64_t)rand() << 11 ^ rand();
+            uint64_t P = r1 & r2, O = r1 & ~r2;
+            int sq = rand() % 64;
+            if (b.get_moves(P, O) != get_moves_scalar(P, O))
+                errors++;
+            if (!((P | O) >> sq & 1) && b.flip(sq, P, O) != flip_scalar(sq, P, O))
+                errors++;
+        }
+        cout << "check_backends: " << b.name << " " << errors << " errors" << endl;
+    }
+    return errors != 0;
+}
+#endif
+
+// 讀一個輸入檔, 把答案寫到輸出檔; 輸入檔不完整 (例如還在寫) 時回傳 false
+// 時間限制從 start 開始算
+bool play_move(Engine & engine, const string & input, const string & output, chrono::steady_clock::time_point start)
+{
+    engine.set_move_start(start);
+    std::ifstream fin(input);
+    engine.read_board(fin);
+    engine.read_valid_spots(fin);
+    if (!fin)
+        return false;
+    fin.close();
+    std::ofstream fout(output);
+    engine.write_valid_spot(fout);
+    fout.close();
+    return true;
+}
+// daemon 模式: 從 stdin 一行讀一組 "輸入檔 輸出檔", 寫完輸出檔後在 stdout 回一行 "done 輸出檔"
+// 兩步之間在背景 ponder (OTHELLO_PONDER=0 關掉)
+int run_daemon()
+{
+    Engine engine;
+    engine.set_ponder(get_env_int("OTHELLO_PONDER", 1));
+    string input, output;
+    while (cin >> input >> output) {
+        bool ok = play_move(engine, input, output, chrono::steady_clock::now());
+        cout << (ok ? "done " : "error ") << output << endl;
+    }
+    return 0;
+}
+// watch 模式: 每 10ms 看一次輸入檔的修改時間, 變了就回答一次 (啟動前就存在的內容不算)
+int run_watch(const string & input, const string & output)
+{
+    Engine engine;
+    engine.set_ponder(get_env_int("OTHELLO_PONDER", 1));
+    filesystem::file_time_type seen;
+    error_code ec;
+    seen = filesystem::last_write_time(input, ec);
+    while (true) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        filesystem::file_time_type t = filesystem::last_write_time(input, ec);
+        if (ec || t == seen)
+            continue;
+        if (play_move(engine, input, output, chrono::steady_clock::now()))
+            seen = t;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && string(argv[1]) == "--daemon")
+        return run_daemon();
+    if (argc == 4 && string(argv[1]) == "--watch")
+        return run_watch(argv[2], argv[3]);
+#ifdef DEBUG_CHECK
+    if (argc == 2 && string(argv[1]) == "bench")
+        return bench_threads(20, 10) | bench_endgame(20, 18);
+    if (argc < 3)
+        return check_boards(1000) | check_backends(1000000) | check_stability(1000) | check_search(200) | check_endgame(200)
+            | check_interrupted_solve(30, 16) | check_cancelled_ponder(100, 10)
+            | check_ponder_root(20) | check_parallel_search(200, 6);
+#endif
+    Engine engine;
+    play_move(engine, argv[1], argv[2], PROCESS_START);
+    return 0;
 }
\ No newline at end of file
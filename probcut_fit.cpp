@@ -0,0 +1,75 @@
+// 從 player.cpp 記錄的搜尋分數 (OTHELLO_PROBCUT_LOG) 算 Multi-ProbCut 的回歸參數
+// 用法: probcut_fit <log 檔> ... , 輸出可以直接貼進 player.cpp 的 PROBCUT_PARAMS
+// 每行記錄: 棋子數 深度 淺層分數 深層分數
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+using namespace std;
+const int PROBCUT_PHASES = 8;
+const int PROBCUT_MAX_DEPTH = 12;
+// 樣本太少的組合不剪
+const int MIN_SAMPLES = 100;
+// 分數的絕對值到這裡就是搜到終局的結果 (player.cpp 的 END_GAME_SCALE), 不是評估函數, 不拿來擬合
+const double END_GAME_SCALE = 10000;
+
+struct Sums {
+    long long n;
+    double x, y, xx, xy, yy;
+};
+Sums sums[PROBCUT_PHASES][PROBCUT_MAX_DEPTH + 1];
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <probcut log> ..." << endl;
+        return 1;
+    }
+    for (int f = 1; f < argc; f++) {
+        ifstream fin(argv[f]);
+        int discs, depth;
+        double shallow, deep;
+        while (fin >> discs >> depth >> shallow >> deep) {
+            if (discs < 4 || discs > 64 || depth < 0 || depth > PROBCUT_MAX_DEPTH)
+                continue;
+            if (fabs(shallow) >= END_GAME_SCALE || fabs(deep) >= END_GAME_SCALE)
+                continue;
+            Sums & s = sums[(discs - 4) / 8][depth];
+            s.n++;
+            s.x += shallow;
+            s.y += deep;
+            s.xx += shallow * shallow;
+            s.xy += shallow * deep;
+            s.yy += deep * deep;
+        }
+    }
+    // 最小平方法: deep = a * shallow + b, sigma 是殘差的標準差
+    printf("const ProbCutParam PROBCUT_PARAMS[PROBCUT_PHASES][PROBCUT_MAX_DEPTH + 1] = {\n");
+    for (int phase = 0; phase < PROBCUT_PHASES; phase++) {
+        printf("    {");
+        for (int depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++) {
+            const Sums & s = sums[phase][depth];
+            double a = 0, b = 0, sigma = 0;
+            double var_x = s.xx - s.x * s.x / max(s.n, 1LL);
+            if (s.n >= MIN_SAMPLES && var_x > 0) {
+                a = (s.xy - s.x * s.y / s.n) / var_x;
+                b = (s.y - a * s.x) / s.n;
+                double sse = s.yy - 2 * a * s.xy - 2 * b * s.y + a * a * s.xx + 2 * a * b * s.x + b * b * s.n;
+                sigma = sqrt(max(sse, 0.0) / (s.n - 2));
+            }
+            if (a <= 0)
+                a = b = sigma = 0;
+            printf("%s{%.3f, %.1f, %.1f}", depth ? ", " : "", a, b, sigma);
+        }
+        printf("},\n");
+    }
+    printf("};\n");
+    // 每組的樣本數印到 stderr 方便檢查
+    for (int phase = 0; phase < PROBCUT_PHASES; phase++) {
+        cerr << "phase " << phase << ":";
+        for (int depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++)
+            cerr << " " << sums[phase][depth].n;
+        cerr << endl;
+    }
+    return 0;
+}